@@ -0,0 +1,67 @@
+#include "asset_cache.hpp"
+#include "SDL3/SDL_log.h"
+#include <cstddef>
+
+// Generated at build time by cmake/embed_asset.cmake
+namespace SdlPong {
+extern const unsigned char kSilkscreenFont[];
+extern const std::size_t kSilkscreenFontSize;
+} // namespace SdlPong
+
+namespace {
+
+struct EmbeddedAsset {
+    const char *name;
+    const unsigned char *data;
+    const std::size_t &size;
+};
+
+// Indexed by FontAsset
+const EmbeddedAsset kFonts[SdlPong::kNumFontAssets]{
+    {"slkscr.ttf", SdlPong::kSilkscreenFont, SdlPong::kSilkscreenFontSize}};
+
+} // namespace
+
+SdlPong::AssetCache::~AssetCache() {
+    // Atlases keep no reference to their font, but go first anyway
+    mAtlases.clear();
+    for (FontEntry &entry : mFonts)
+        TTF_CloseFont(entry.font);
+}
+
+/* TTF_Font *SdlPong::AssetCache::getFont {{{ */
+TTF_Font *SdlPong::AssetCache::getFont(FontAsset asset, float size) {
+    for (const FontEntry &entry : mFonts) {
+        if (entry.asset == asset && entry.size == size)
+            return entry.font;
+    }
+
+    // The stream reads the embedded bytes in place, without a copy, and is
+    // closed together with the font
+    const EmbeddedAsset &embedded{kFonts[asset]};
+    SDL_IOStream *stream{SDL_IOFromConstMem(embedded.data, embedded.size)};
+    TTF_Font *font{stream ? TTF_OpenFontIO(stream, true, size) : nullptr};
+    if (font == nullptr) {
+        SDL_Log("Could not load %s! SDL_ttf Error: %s\n", embedded.name,
+                SDL_GetError());
+        return nullptr;
+    }
+
+    mFonts.push_back({.asset = asset, .size = size, .font = font});
+    return font;
+} /* }}} */
+
+/* SdlPong::GlyphAtlas *SdlPong::AssetCache::getAtlas {{{ */
+SdlPong::GlyphAtlas *SdlPong::AssetCache::getAtlas(FontAsset asset,
+                                                   float size) {
+    for (const AtlasEntry &entry : mAtlases) {
+        if (entry.asset == asset && entry.size == size)
+            return entry.atlas.get();
+    }
+
+    mAtlases.push_back(
+        {.asset = asset,
+         .size = size,
+         .atlas = std::make_unique<GlyphAtlas>(getFont(asset, size))});
+    return mAtlases.back().atlas.get();
+} /* }}} */
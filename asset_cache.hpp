@@ -0,0 +1,53 @@
+#ifndef _JC_ASSET_CACHE
+#define _JC_ASSET_CACHE
+
+#include "glyph_atlas.hpp"
+#include <SDL3_ttf/SDL_ttf.h>
+#include <memory>
+#include <vector>
+
+namespace SdlPong {
+
+// Assets compiled into the executable
+enum FontAsset { silkscreenFont };
+
+constexpr int kNumFontAssets{silkscreenFont + 1};
+
+/* class AssetCache {{{
+ * Loads every asset once and hands out shared handles that stay valid for
+ * the life of the cache. Fonts are parsed straight from the copy embedded
+ * in the executable, so nothing is read from disk and the working directory
+ * does not matter. Must be destroyed before TTF_Quit.
+ * */
+class AssetCache {
+  public:
+    AssetCache() = default;
+    ~AssetCache();
+    AssetCache(const AssetCache &) = delete;
+    AssetCache &operator=(const AssetCache &) = delete;
+
+    // Null, after logging why, if the font could not be opened
+    TTF_Font *getFont(FontAsset asset, float size);
+    // Never null; the atlas is empty if its font could not be opened
+    GlyphAtlas *getAtlas(FontAsset asset, float size);
+
+  private:
+    struct FontEntry {
+        FontAsset asset;
+        float size;
+        TTF_Font *font;
+    };
+    struct AtlasEntry {
+        FontAsset asset;
+        float size;
+        std::unique_ptr<GlyphAtlas> atlas;
+    };
+
+    // A handful of entries at most, so plain vectors are searched
+    std::vector<FontEntry> mFonts;
+    std::vector<AtlasEntry> mAtlases;
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_ASSET_CACHE */
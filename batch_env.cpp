@@ -0,0 +1,137 @@
+#include "batch_env.hpp"
+#include "batch_env_kernel.hpp"
+#include <cassert>
+#include <cstdlib>
+
+namespace {
+
+// One match per "vector"; every operation is still branch-free
+struct ScalarOps {
+    using V = int;
+    static constexpr int kWidth{1};
+
+    static V load(const int *p) { return *p; }
+    static void store(int *p, V v) { *p = v; }
+    static V loadAction(const std::int8_t *p) { return *p; }
+    static V set1(int v) { return v; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+    static V neg(V a) { return -a; }
+    static V abs(V a) { return std::abs(a); }
+    static V bitAnd(V a, V b) { return a & b; }
+    static V bitOr(V a, V b) { return a | b; }
+    static V andNot(V a, V b) { return ~a & b; }
+    static V lt(V a, V b) { return -static_cast<int>(a < b); }
+    static V select(V mask, V t, V f) { return (mask & t) | (~mask & f); }
+};
+
+} // namespace
+
+void SdlPong::StepBatchScalar(const BatchLayout &layout,
+                              const BatchLanes &lanes, int begin, int end) {
+    SdlPong::StepBatchLanes<ScalarOps>(layout, lanes, begin, end);
+}
+
+/* SdlPong::BatchEnv::BatchEnv {{{ */
+SdlPong::BatchEnv::BatchEnv(int numMatches, int tickRate)
+    : leftAction(numMatches, 0), rightAction(numMatches, 0),
+      ballX(numMatches), ballY(numMatches), ballXvel(numMatches),
+      ballYvel(numMatches), leftBarY(numMatches), leftBarYvel(numMatches),
+      rightBarY(numMatches), rightBarYvel(numMatches),
+      leftScore(numMatches), rightScore(numMatches), reward(numMatches, 0),
+      mKernel{SdlPong::StepBatchScalar}, mKernelName{"scalar"} {
+
+    assert(numMatches >= 0 && "Negative number of matches");
+
+    // Take the layout from a regular match so the rules stay identical
+    SdlPong::Simulation sim{tickRate};
+    SdlPong::Rect ball{sim.getGraphicBox(SdlPong::ball).rect};
+    SdlPong::Rect leftBar{sim.getGraphicBox(SdlPong::leftBar).rect};
+    SdlPong::Rect rightBar{sim.getGraphicBox(SdlPong::rightBar).rect};
+
+    assert(leftBar.w == rightBar.w && leftBar.h == rightBar.h &&
+           leftBar.y == rightBar.y && "Bars must be alike");
+
+    mLayout.barVel = sim.getBarVel();
+    mLayout.ballW = ball.w;
+    mLayout.ballH = ball.h;
+    mLayout.ballInitX = ball.x;
+    mLayout.ballInitY = ball.y;
+    mLayout.barW = leftBar.w;
+    mLayout.barH = leftBar.h;
+    mLayout.leftBarX = leftBar.x;
+    mLayout.rightBarX = rightBar.x;
+    mLayout.barInitY = leftBar.y;
+    mLayout.topWall = sim.getGraphicBox(SdlPong::topWall).rect;
+    mLayout.bottomWall = sim.getGraphicBox(SdlPong::bottomWall).rect;
+    mLayout.leftWall = sim.getGraphicBox(SdlPong::leftWall).rect;
+    mLayout.rightWall = sim.getGraphicBox(SdlPong::rightWall).rect;
+
+    // Pick the widest kernel this CPU runs
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+#ifdef PONG_HAVE_SSE41
+    if (__builtin_cpu_supports("sse4.1")) {
+        mKernel = SdlPong::StepBatchSSE41;
+        mKernelName = "sse4.1";
+    }
+#endif
+#ifdef PONG_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        mKernel = SdlPong::StepBatchAVX2;
+        mKernelName = "avx2";
+    }
+#endif
+#endif
+
+    resetAll();
+}
+/* }}} */
+
+void SdlPong::BatchEnv::reset(int match) {
+    ballX[match] = mLayout.ballInitX;
+    ballY[match] = mLayout.ballInitY;
+    ballXvel[match] = mLayout.barVel;
+    ballYvel[match] = 0;
+    leftBarY[match] = mLayout.barInitY;
+    leftBarYvel[match] = 0;
+    rightBarY[match] = mLayout.barInitY;
+    rightBarYvel[match] = 0;
+    leftScore[match] = 0;
+    rightScore[match] = 0;
+    reward[match] = 0;
+}
+
+void SdlPong::BatchEnv::resetAll() {
+    for (int i{0}; i < size(); ++i)
+        reset(i);
+}
+
+void SdlPong::BatchEnv::step() { mKernel(mLayout, lanes(), 0, size()); }
+
+int SdlPong::BatchEnv::size() const {
+    return static_cast<int>(ballX.size());
+}
+
+const SdlPong::BatchLayout &SdlPong::BatchEnv::getLayout() const {
+    return mLayout;
+}
+
+const char *SdlPong::BatchEnv::getKernelName() const { return mKernelName; }
+
+SdlPong::BatchLanes SdlPong::BatchEnv::lanes() {
+    return {.leftAction = leftAction.data(),
+            .rightAction = rightAction.data(),
+            .ballX = ballX.data(),
+            .ballY = ballY.data(),
+            .ballXvel = ballXvel.data(),
+            .ballYvel = ballYvel.data(),
+            .leftBarY = leftBarY.data(),
+            .leftBarYvel = leftBarYvel.data(),
+            .rightBarY = rightBarY.data(),
+            .rightBarYvel = rightBarYvel.data(),
+            .leftScore = leftScore.data(),
+            .rightScore = rightScore.data(),
+            .reward = reward.data()};
+}
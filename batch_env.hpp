@@ -0,0 +1,118 @@
+#ifndef _JC_BATCH_ENV
+#define _JC_BATCH_ENV
+
+#include "pong_sim.hpp"
+#include <cstdint>
+#include <vector>
+
+// Many independent two-player matches advanced in lockstep, one SIMD lane
+// per match. Applies the same rules as Simulation::step with both bars
+// driven by actions.
+
+namespace SdlPong {
+
+// Geometry shared by every match in a batch, taken from a Simulation so the
+// two stay in sync
+struct BatchLayout {
+    int barVel;
+
+    int ballW;
+    int ballH;
+    int ballInitX;
+    int ballInitY;
+
+    int barW;
+    int barH;
+    int leftBarX;
+    int rightBarX;
+    int barInitY;
+
+    Rect topWall;
+    Rect bottomWall;
+    Rect leftWall;
+    Rect rightWall;
+};
+
+// Raw views of the per-match arrays handed to the kernels
+struct BatchLanes {
+    const std::int8_t *leftAction;
+    const std::int8_t *rightAction;
+
+    int *ballX;
+    int *ballY;
+    int *ballXvel;
+    int *ballYvel;
+    int *leftBarY;
+    int *leftBarYvel;
+    int *rightBarY;
+    int *rightBarYvel;
+
+    int *leftScore;
+    int *rightScore;
+    int *reward;
+};
+
+// Kernels, each advancing matches [begin, end) by one tick
+void StepBatchScalar(const BatchLayout &layout, const BatchLanes &lanes,
+                     int begin, int end);
+#ifdef PONG_HAVE_SSE41
+void StepBatchSSE41(const BatchLayout &layout, const BatchLanes &lanes,
+                    int begin, int end);
+#endif
+#ifdef PONG_HAVE_AVX2
+void StepBatchAVX2(const BatchLayout &layout, const BatchLanes &lanes,
+                   int begin, int end);
+#endif
+
+class BatchEnv {
+
+  public:
+    explicit BatchEnv(int numMatches, int tickRate = kBaseTickRate);
+
+    // Put a match back to the state right after Simulation::startGame
+    void reset(int match);
+    void resetAll();
+
+    // Advance every match by one tick using leftAction and rightAction
+    void step();
+
+    int size() const;
+    const BatchLayout &getLayout() const;
+    // Name of the kernel picked for this CPU
+    const char *getKernelName() const;
+
+    // Actions, written by the caller before step():
+    // -1 moves the bar up, 0 stops it and 1 moves it down
+    std::vector<std::int8_t> leftAction;
+    std::vector<std::int8_t> rightAction;
+
+    // Per-match state, in Simulation units
+    std::vector<int> ballX;
+    std::vector<int> ballY;
+    std::vector<int> ballXvel;
+    std::vector<int> ballYvel;
+    std::vector<int> leftBarY;
+    std::vector<int> leftBarYvel;
+    std::vector<int> rightBarY;
+    std::vector<int> rightBarYvel;
+
+    std::vector<int> leftScore;
+    std::vector<int> rightScore;
+    // Outcome of the last step from the left player's point of view:
+    // 1 if left scored, -1 if right scored, otherwise 0
+    std::vector<int> reward;
+
+  private:
+    using Kernel = void (*)(const BatchLayout &, const BatchLanes &, int,
+                            int);
+
+    BatchLanes lanes();
+
+    BatchLayout mLayout;
+    Kernel mKernel;
+    const char *mKernelName;
+};
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_BATCH_ENV */
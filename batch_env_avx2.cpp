@@ -0,0 +1,43 @@
+// Compiled with -mavx2; only called after a runtime CPU check
+#include "batch_env.hpp"
+#include "batch_env_kernel.hpp"
+#include <immintrin.h>
+
+namespace {
+
+struct AVX2Ops {
+    using V = __m256i;
+    static constexpr int kWidth{8};
+
+    static V load(const int *p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+    static void store(int *p, V v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+    }
+    static V loadAction(const std::int8_t *p) {
+        return _mm256_cvtepi8_epi32(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+    }
+    static V set1(int v) { return _mm256_set1_epi32(v); }
+    static V add(V a, V b) { return _mm256_add_epi32(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_epi32(a, b); }
+    static V mul(V a, V b) { return _mm256_mullo_epi32(a, b); }
+    static V neg(V a) { return _mm256_sub_epi32(_mm256_setzero_si256(), a); }
+    static V abs(V a) { return _mm256_abs_epi32(a); }
+    static V bitAnd(V a, V b) { return _mm256_and_si256(a, b); }
+    static V bitOr(V a, V b) { return _mm256_or_si256(a, b); }
+    static V andNot(V a, V b) { return _mm256_andnot_si256(a, b); }
+    static V lt(V a, V b) { return _mm256_cmpgt_epi32(b, a); }
+    static V select(V mask, V t, V f) {
+        return _mm256_blendv_epi8(f, t, mask);
+    }
+};
+
+} // namespace
+
+void SdlPong::StepBatchAVX2(const BatchLayout &layout, const BatchLanes &lanes,
+                            int begin, int end) {
+    int done{SdlPong::StepBatchLanes<AVX2Ops>(layout, lanes, begin, end)};
+    SdlPong::StepBatchScalar(layout, lanes, done, end);
+}
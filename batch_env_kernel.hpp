@@ -0,0 +1,151 @@
+#ifndef _JC_BATCH_ENV_KERNEL
+#define _JC_BATCH_ENV_KERNEL
+
+#include "batch_env.hpp"
+
+// Branch-free BatchEnv tick written once against a small set of lane
+// operations. Each kernel translation unit includes this with its own Ops
+// and its own instruction set flags.
+//
+// Ops provides, for a vector type V of Ops::kWidth int lanes:
+//   load, store, loadAction (int8 -> int), set1, add, sub, mul, neg, abs,
+//   bitAnd, bitOr, andNot(a, b) = ~a & b, lt (all ones where a < b) and
+//   select(mask, ifTrue, ifFalse).
+
+namespace SdlPong {
+namespace {
+
+/* template <typename Ops> Overlap {{{
+ * Same test as HasIntersection for non-empty rects.
+ * */
+template <typename Ops>
+typename Ops::V Overlap(typename Ops::V ax, typename Ops::V ay,
+                        typename Ops::V aw, typename Ops::V ah,
+                        typename Ops::V bx, typename Ops::V by,
+                        typename Ops::V bw, typename Ops::V bh) {
+    return Ops::bitAnd(
+        Ops::bitAnd(Ops::lt(ax, Ops::add(bx, bw)),
+                    Ops::lt(bx, Ops::add(ax, aw))),
+        Ops::bitAnd(Ops::lt(ay, Ops::add(by, bh)),
+                    Ops::lt(by, Ops::add(ay, ah))));
+} /* }}} */
+
+template <typename Ops>
+typename Ops::V OverlapRect(typename Ops::V x, typename Ops::V y,
+                            typename Ops::V w, typename Ops::V h,
+                            const Rect &r) {
+    return Overlap<Ops>(x, y, w, h, Ops::set1(r.x), Ops::set1(r.y),
+                        Ops::set1(r.w), Ops::set1(r.h));
+}
+
+/* template <typename Ops> int StepBatchLanes {{{
+ * Advance whole vectors of matches starting at begin. Returns the first
+ * match that was not stepped because fewer than Ops::kWidth remain.
+ * */
+template <typename Ops>
+int StepBatchLanes(const BatchLayout &layout, const BatchLanes &lanes,
+                   int begin, int end) {
+    using V = typename Ops::V;
+
+    const V zero{Ops::set1(0)};
+    const V barVel{Ops::set1(layout.barVel)};
+    const V ballW{Ops::set1(layout.ballW)};
+    const V ballH{Ops::set1(layout.ballH)};
+    const V barW{Ops::set1(layout.barW)};
+    const V barH{Ops::set1(layout.barH)};
+    const V leftBarX{Ops::set1(layout.leftBarX)};
+    const V rightBarX{Ops::set1(layout.rightBarX)};
+    const V belowTop{Ops::set1(layout.topWall.y + layout.topWall.h)};
+    const V aboveBottom{Ops::set1(layout.bottomWall.y - layout.barH)};
+
+    int i{begin};
+    for (; i + Ops::kWidth <= end; i += Ops::kWidth) {
+
+        // Bars follow the actions
+        V leftYvel{Ops::mul(Ops::loadAction(lanes.leftAction + i), barVel)};
+        V rightYvel{Ops::mul(Ops::loadAction(lanes.rightAction + i), barVel)};
+
+        // Move every body by its velocity
+        V ballXvel{Ops::load(lanes.ballXvel + i)};
+        V ballYvel{Ops::load(lanes.ballYvel + i)};
+        V ballX{Ops::add(Ops::load(lanes.ballX + i), ballXvel)};
+        V ballY{Ops::add(Ops::load(lanes.ballY + i), ballYvel)};
+        V leftY{Ops::add(Ops::load(lanes.leftBarY + i), leftYvel)};
+        V rightY{Ops::add(Ops::load(lanes.rightBarY + i), rightYvel)};
+
+        // Ball against bars and walls. A later collision replaces the
+        // response of an earlier one, in the order CheckCollisions visits
+        // them: left bar, right bar, top and bottom wall.
+        V hitLeft{Overlap<Ops>(ballX, ballY, ballW, ballH, leftBarX, leftY,
+                               barW, barH)};
+        V hitRight{Overlap<Ops>(ballX, ballY, ballW, ballH, rightBarX, rightY,
+                                barW, barH)};
+        V hitTB{Ops::bitOr(
+            OverlapRect<Ops>(ballX, ballY, ballW, ballH, layout.topWall),
+            OverlapRect<Ops>(ballX, ballY, ballW, ballH, layout.bottomWall))};
+
+        V absXvel{Ops::abs(ballXvel)};
+        V postXvel{Ops::select(hitLeft, absXvel, ballXvel)};
+        V postYvel{Ops::select(hitLeft, leftYvel, ballYvel)};
+        postXvel = Ops::select(hitRight, Ops::neg(absXvel), postXvel);
+        postYvel = Ops::select(hitRight, rightYvel, postYvel);
+        postXvel = Ops::select(hitTB, ballXvel, postXvel);
+        postYvel = Ops::select(hitTB, Ops::neg(ballYvel), postYvel);
+
+        // Touching a side wall scores and resets the ball towards the
+        // player who lost the point. The left wall is checked first.
+        V rightScored{
+            OverlapRect<Ops>(ballX, ballY, ballW, ballH, layout.leftWall)};
+        V leftScored{Ops::andNot(
+            rightScored,
+            OverlapRect<Ops>(ballX, ballY, ballW, ballH, layout.rightWall))};
+        V scored{Ops::bitOr(leftScored, rightScored)};
+
+        ballX = Ops::select(scored, Ops::set1(layout.ballInitX), ballX);
+        ballY = Ops::select(scored, Ops::set1(layout.ballInitY), ballY);
+        postXvel = Ops::select(leftScored, barVel, postXvel);
+        postXvel = Ops::select(rightScored, Ops::neg(barVel), postXvel);
+        postYvel = Ops::select(scored, zero, postYvel);
+
+        // Stop bars from going out of bounds
+        V leftHitTop{
+            OverlapRect<Ops>(leftBarX, leftY, barW, barH, layout.topWall)};
+        V leftHitBottom{
+            OverlapRect<Ops>(leftBarX, leftY, barW, barH, layout.bottomWall)};
+        V rightHitTop{
+            OverlapRect<Ops>(rightBarX, rightY, barW, barH, layout.topWall)};
+        V rightHitBottom{OverlapRect<Ops>(rightBarX, rightY, barW, barH,
+                                          layout.bottomWall)};
+
+        leftY = Ops::select(leftHitTop, belowTop, leftY);
+        leftY = Ops::select(leftHitBottom, aboveBottom, leftY);
+        leftYvel =
+            Ops::select(Ops::bitOr(leftHitTop, leftHitBottom), zero, leftYvel);
+        rightY = Ops::select(rightHitTop, belowTop, rightY);
+        rightY = Ops::select(rightHitBottom, aboveBottom, rightY);
+        rightYvel = Ops::select(Ops::bitOr(rightHitTop, rightHitBottom), zero,
+                                rightYvel);
+
+        Ops::store(lanes.ballX + i, ballX);
+        Ops::store(lanes.ballY + i, ballY);
+        Ops::store(lanes.ballXvel + i, postXvel);
+        Ops::store(lanes.ballYvel + i, postYvel);
+        Ops::store(lanes.leftBarY + i, leftY);
+        Ops::store(lanes.leftBarYvel + i, leftYvel);
+        Ops::store(lanes.rightBarY + i, rightY);
+        Ops::store(lanes.rightBarYvel + i, rightYvel);
+
+        // Masks are all ones (-1) where true
+        Ops::store(lanes.leftScore + i,
+                   Ops::sub(Ops::load(lanes.leftScore + i), leftScored));
+        Ops::store(lanes.rightScore + i,
+                   Ops::sub(Ops::load(lanes.rightScore + i), rightScored));
+        Ops::store(lanes.reward + i, Ops::sub(rightScored, leftScored));
+    }
+    return i;
+} /* }}} */
+
+} // namespace
+} // namespace SdlPong
+
+#endif /* ifndef _JC_BATCH_ENV_KERNEL */
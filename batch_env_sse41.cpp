@@ -0,0 +1,43 @@
+// Compiled with -msse4.1; only called after a runtime CPU check
+#include "batch_env.hpp"
+#include "batch_env_kernel.hpp"
+#include <cstring>
+#include <smmintrin.h>
+
+namespace {
+
+struct SSE41Ops {
+    using V = __m128i;
+    static constexpr int kWidth{4};
+
+    static V load(const int *p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    }
+    static void store(int *p, V v) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+    }
+    static V loadAction(const std::int8_t *p) {
+        int packed;
+        std::memcpy(&packed, p, sizeof(packed));
+        return _mm_cvtepi8_epi32(_mm_cvtsi32_si128(packed));
+    }
+    static V set1(int v) { return _mm_set1_epi32(v); }
+    static V add(V a, V b) { return _mm_add_epi32(a, b); }
+    static V sub(V a, V b) { return _mm_sub_epi32(a, b); }
+    static V mul(V a, V b) { return _mm_mullo_epi32(a, b); }
+    static V neg(V a) { return _mm_sub_epi32(_mm_setzero_si128(), a); }
+    static V abs(V a) { return _mm_abs_epi32(a); }
+    static V bitAnd(V a, V b) { return _mm_and_si128(a, b); }
+    static V bitOr(V a, V b) { return _mm_or_si128(a, b); }
+    static V andNot(V a, V b) { return _mm_andnot_si128(a, b); }
+    static V lt(V a, V b) { return _mm_cmplt_epi32(a, b); }
+    static V select(V mask, V t, V f) { return _mm_blendv_epi8(f, t, mask); }
+};
+
+} // namespace
+
+void SdlPong::StepBatchSSE41(const BatchLayout &layout,
+                             const BatchLanes &lanes, int begin, int end) {
+    int done{SdlPong::StepBatchLanes<SSE41Ops>(layout, lanes, begin, end)};
+    SdlPong::StepBatchScalar(layout, lanes, done, end);
+}
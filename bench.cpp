@@ -0,0 +1,417 @@
+#include "batch_env.hpp"
+#include "collision.hpp"
+#include "collision_response.hpp"
+#include "entity_store.hpp"
+#include "mlp.hpp"
+#include "pong_sim.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef PONG_BENCH_SDL
+#include "asset_cache.hpp"
+#include "particle_system.hpp"
+#include "render_queue.hpp"
+#include "sdl_pong.hpp"
+#endif
+
+// Repeatable benchmarks of the hot paths, printed as JSON so results can be
+// compared across commits. Every scenario is seeded and does the same work
+// on every run; the median of several runs is reported.
+
+namespace {
+
+struct Options {
+    int runs{5};
+    double scale{1.0}; // multiplies the work done per run
+    const char *filter{nullptr};
+};
+
+struct Result {
+    std::string name;
+    std::string unit; // what one operation is
+    long long param;  // scenario size, e.g. body count; 0 if none
+    long long ops;    // operations per run
+    double medianSeconds;
+    double minSeconds;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps the optimizer from dropping work whose result is unused
+volatile long long gSink;
+
+/* template <typename F> Result Measure {{{
+ * Time run() options.runs times after one warm-up run. run does ops
+ * operations each time.
+ * */
+template <typename F>
+Result Measure(const Options &options, std::string name, std::string unit,
+               long long param, long long ops, F &&run) {
+    run();
+
+    std::vector<double> seconds;
+    for (int i{0}; i < options.runs; ++i) {
+        auto start{Clock::now()};
+        run();
+        seconds.push_back(
+            std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    std::sort(seconds.begin(), seconds.end());
+
+    return {.name = std::move(name),
+            .unit = std::move(unit),
+            .param = param,
+            .ops = ops,
+            .medianSeconds = seconds[seconds.size() / 2],
+            .minSeconds = seconds.front()};
+} /* }}} */
+
+bool Selected(const Options &options, const char *name) {
+    return options.filter == nullptr ||
+           std::strstr(name, options.filter) != nullptr;
+}
+
+long long Scaled(const Options &options, long long ops) {
+    long long scaled{static_cast<long long>(ops * options.scale)};
+    return scaled > 0 ? scaled : 1;
+}
+
+/* void BenchSimulation {{{
+ * A full match: both bars follow the ball so rallies are long and every
+ * collision path is taken.
+ * */
+void BenchSimulation(const Options &options, std::vector<Result> &results) {
+    const long long ticks{Scaled(options, 200000)};
+
+    for (bool continuous : {false, true}) {
+        const char *name{continuous ? "sim_step_continuous" : "sim_step"};
+        if (!Selected(options, name))
+            continue;
+
+        results.push_back(Measure(options, name, "tick", 0, ticks, [&] {
+            SdlPong::Simulation sim;
+            sim.setContinuousCollisions(continuous);
+            sim.startGame(true);
+            for (long long t{0}; t < ticks; ++t) {
+                int ballY{sim.getGraphicBox(SdlPong::ball).rect.y};
+                int barY{sim.getGraphicBox(SdlPong::rightBar).rect.y};
+                sim.step({.left = SdlPong::none,
+                          .right = ballY > barY ? SdlPong::down
+                                                : SdlPong::up});
+            }
+            gSink = sim.getScore(SdlPong::left);
+        }));
+    }
+} /* }}} */
+
+/* void BenchCollisions {{{
+ * Many balls bouncing between walls and bars, stepped with the same
+ * pipeline as Simulation: UpdatePositions, broad phase, responses and
+ * HandleCollisions.
+ * */
+void BenchCollisions(const Options &options, std::vector<Result> &results) {
+    if (!Selected(options, "collisions"))
+        return;
+
+    constexpr int size{SdlPong::ToFixed(1024)};
+    constexpr int wall{SdlPong::ToFixed(16)};
+    const SdlPong::Color white{0xFF, 0xFF, 0xFF, 0xFF};
+
+    for (int bodies : {16, 64, 256, 1024, 4096}) {
+        const long long ticks{Scaled(options, 4000000 / bodies + 50)};
+
+        results.push_back(Measure(
+            options, "collisions", "body_tick", bodies, ticks * bodies, [&] {
+                std::minstd_rand rng{static_cast<std::uint32_t>(bodies)};
+                std::uniform_int_distribution<int> pos{2 * wall,
+                                                       size - 4 * wall};
+                std::uniform_int_distribution<int> vel{-wall / 4, wall / 4};
+
+                SdlPong::EntityStore es;
+                const SdlPong::RigidBody still{0, 0};
+                es.add({{0, -wall, size, wall}, white}, still,
+                       SdlPong::topWall);
+                es.add({{0, size, size, wall}, white}, still,
+                       SdlPong::bottomWall);
+                es.add({{0, 0, wall, size}, white}, still, SdlPong::leftBar);
+                es.add({{size - wall, 0, wall, size}, white}, still,
+                       SdlPong::rightBar);
+                for (int i{0}; i < bodies; ++i)
+                    es.add({{pos(rng), pos(rng), wall / 2, wall / 2}, white},
+                           {vel(rng), vel(rng)}, SdlPong::ball);
+
+                SdlPong::BroadPhase broadPhase;
+                long long pairs{0};
+                for (long long t{0}; t < ticks; ++t) {
+                    es.UpdatePositions();
+                    for (const SdlPong::CollisionPair &pair :
+                         broadPhase.FindPairs(es)) {
+                        ++pairs;
+                        if (SdlPong::RespondsTo(es.id[pair.a], es.id[pair.b]))
+                            es.RegisterCollision(pair.a, pair.b);
+                        if (SdlPong::RespondsTo(es.id[pair.b], es.id[pair.a]))
+                            es.RegisterCollision(pair.b, pair.a);
+                    }
+                    es.HandleCollisions();
+                }
+                gSink = pairs;
+            }));
+    }
+} /* }}} */
+
+/* void BenchBatchEnv {{{ */
+void BenchBatchEnv(const Options &options, std::vector<Result> &results) {
+    if (!Selected(options, "batch_env"))
+        return;
+
+    constexpr int matches{4096};
+    const long long ticks{Scaled(options, 2000)};
+    SdlPong::BatchEnv env{matches};
+
+    results.push_back(Measure(
+        options, std::string{"batch_env_"} + env.getKernelName(),
+        "match_tick", matches, ticks * matches, [&] {
+            env.resetAll();
+            std::minstd_rand rng{1};
+            for (long long t{0}; t < ticks; ++t) {
+                // Cheap varying actions without a per-lane RNG call
+                std::int8_t action{static_cast<std::int8_t>(rng() % 3 - 1)};
+                std::fill(env.leftAction.begin(), env.leftAction.end(),
+                          action);
+                std::fill(env.rightAction.begin(), env.rightAction.end(),
+                          static_cast<std::int8_t>(-action));
+                env.step();
+            }
+            gSink = env.leftScore[0];
+        }));
+} /* }}} */
+
+/* void BenchMlp {{{
+ * A policy sized network, 8 -> 64 -> 64 -> 3, evaluated for a batch of
+ * matches at a time
+ * */
+void BenchMlp(const Options &options, std::vector<Result> &results) {
+    constexpr int batch{4096};
+    const int sizes[]{8, 64, 64, 3};
+    const long long passes{Scaled(options, 200)};
+
+    SdlPong::Mlp net;
+    std::minstd_rand rng{1};
+    std::uniform_real_distribution<float> weight{-0.5f, 0.5f};
+    for (int l{0}; l < 3; ++l) {
+        std::vector<float> weights(sizes[l] * sizes[l + 1]);
+        std::vector<float> bias(sizes[l + 1]);
+        std::generate(weights.begin(), weights.end(),
+                      [&] { return weight(rng); });
+        std::generate(bias.begin(), bias.end(), [&] { return weight(rng); });
+        net.addLayer(sizes[l], sizes[l + 1],
+                     l < 2 ? SdlPong::reluActivation
+                           : SdlPong::linearActivation,
+                     weights.data(), bias.data());
+    }
+
+    std::vector<float> inputs(batch * sizes[0]);
+    std::vector<float> outputs(batch * sizes[3]);
+    std::generate(inputs.begin(), inputs.end(), [&] { return weight(rng); });
+    SdlPong::MlpWorkspace workspace;
+
+    for (bool quantized : {false, true}) {
+        std::string name{std::string{"mlp_"} + (quantized ? "int8" : "float") +
+                         "_" + net.getKernelName()};
+        if (!Selected(options, name.c_str()))
+            continue;
+
+        results.push_back(
+            Measure(options, name, "inference", batch, passes * batch, [&] {
+                for (long long p{0}; p < passes; ++p)
+                    net.Forward(inputs.data(), batch, outputs.data(),
+                                workspace, quantized);
+                gSink = static_cast<long long>(outputs[0]);
+            }));
+    }
+} /* }}} */
+
+#ifdef PONG_BENCH_SDL
+/* void BenchSetText {{{ */
+void BenchSetText(const Options &options, std::vector<Result> &results) {
+    if (!Selected(options, "set_text"))
+        return;
+
+    const long long calls{Scaled(options, 200000)};
+    SdlPong::AssetCache assets;
+    SdlPong::GlyphAtlas &atlas{*assets.getAtlas(SdlPong::silkscreenFont, 28)};
+    const SdlPong::GraphicBox box{.rect = {100, 20, 0, 0},
+                                  .color = {0xFF, 0xFF, 0xFF, 0xFF}};
+    SdlPong::TextBody body{&atlas, box};
+
+    results.push_back(Measure(options, "set_text", "call", 0, calls, [&] {
+        char digits[16];
+        for (long long i{0}; i < calls; ++i) {
+            int length{std::snprintf(digits, sizeof(digits), "%lld",
+                                     i % 100)};
+            body.setText({digits, static_cast<std::size_t>(length)});
+        }
+    }));
+} /* }}} */
+
+/* void BenchRenderSubmit {{{
+ * Queue and submit frames into a software renderer on an offscreen
+ * surface: a game frame, then frames with many more rects.
+ * */
+void BenchRenderSubmit(const Options &options,
+                       std::vector<Result> &results) {
+    if (!Selected(options, "render_submit"))
+        return;
+
+    SDL_Surface *surface{SDL_CreateSurface(640, 480, SDL_PIXELFORMAT_RGBA32)};
+    SDL_Renderer *renderer{surface ? SDL_CreateSoftwareRenderer(surface)
+                                   : nullptr};
+    if (renderer == nullptr) {
+        std::fprintf(stderr, "Offscreen renderer unavailable: %s\n",
+                     SDL_GetError());
+        SDL_DestroySurface(surface);
+        return;
+    }
+
+    SdlPong::AssetCache assets;
+    SdlPong::GlyphAtlas &atlas{*assets.getAtlas(SdlPong::silkscreenFont, 28)};
+    SDL_Texture *texture{atlas.getTexture(renderer)};
+    SdlPong::RenderQueue queue;
+    const SDL_FColor white{1, 1, 1, 1};
+
+    for (int rects : {3, 100, 1000}) {
+        const long long frames{Scaled(options, 300000 / (rects + 100))};
+        results.push_back(Measure(
+            options, "render_submit", "frame", rects, frames, [&] {
+                std::minstd_rand rng{static_cast<std::uint32_t>(rects)};
+                for (long long f{0}; f < frames; ++f) {
+                    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xFF);
+                    SDL_RenderClear(renderer);
+                    for (int r{0}; r < rects; ++r)
+                        queue.AddRect({static_cast<float>(rng() % 620),
+                                       static_cast<float>(rng() % 460), 20,
+                                       20},
+                                      white);
+                    queue.AddText(atlas, texture, "10", 160, 20, white);
+                    queue.AddText(atlas, texture, "7", 480, 20, white);
+                    queue.Submit(renderer);
+                    SDL_RenderPresent(renderer);
+                }
+            }));
+    }
+
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroySurface(surface);
+} /* }}} */
+
+/* void BenchParticles {{{
+ * Update a pool of live particles and build its vertex batch, without
+ * drawing it, at growing particle counts.
+ * */
+void BenchParticles(const Options &options, std::vector<Result> &results) {
+    if (!Selected(options, "particles"))
+        return;
+
+    SdlPong::RenderQueue queue;
+    for (int count : {1000, 10000, 50000}) {
+        SdlPong::ParticleSystem particles{count};
+        const long long frames{Scaled(options, 20000000 / count)};
+        results.push_back(Measure(
+            options, "particles", "particle", count, frames * count, [&] {
+                for (long long f{0}; f < frames; ++f) {
+                    // Keep the pool full, with no particle living to the end
+                    if (particles.size() < count)
+                        particles.Burst(320, 240, count - particles.size(),
+                                        600, {1, 1, 1, 1});
+                    particles.Update(1.0f / 600);
+                    particles.Render(queue);
+                    queue.clear();
+                }
+                gSink = particles.size();
+            }));
+    }
+} /* }}} */
+#endif
+
+/* void WriteJson {{{ */
+void WriteJson(std::FILE *out, const Options &options,
+               const std::vector<Result> &results) {
+    std::fprintf(out, "{\n  \"runs\": %d,\n  \"scale\": %g,\n", options.runs,
+                 options.scale);
+    std::fputs("  \"benchmarks\": [", out);
+    for (std::size_t i{0}; i < results.size(); ++i) {
+        const Result &r{results[i]};
+        std::fprintf(out,
+                     "%s\n    {\"name\": \"%s\", \"unit\": \"%s\", "
+                     "\"param\": %lld, \"ops\": %lld, "
+                     "\"median_s\": %.6f, \"min_s\": %.6f, "
+                     "\"ops_per_s\": %.1f, \"ns_per_op\": %.3f}",
+                     i == 0 ? "" : ",", r.name.c_str(), r.unit.c_str(),
+                     r.param, r.ops, r.medianSeconds, r.minSeconds,
+                     r.ops / r.medianSeconds, r.medianSeconds * 1e9 / r.ops);
+    }
+    std::fputs("\n  ]\n}\n", out);
+} /* }}} */
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Options options;
+    const char *outPath{nullptr};
+
+    for (int i{1}; i < argc - 1; i += 2) {
+        if (std::strcmp(argv[i], "--runs") == 0)
+            options.runs = std::atoi(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--scale") == 0)
+            options.scale = std::atof(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--filter") == 0)
+            options.filter = argv[i + 1];
+        else if (std::strcmp(argv[i], "--out") == 0)
+            outPath = argv[i + 1];
+        else {
+            std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (options.runs <= 0 || options.scale <= 0) {
+        std::fprintf(stderr, "Invalid options\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Result> results;
+    BenchSimulation(options, results);
+    BenchCollisions(options, results);
+    BenchBatchEnv(options, results);
+    BenchMlp(options, results);
+
+#ifdef PONG_BENCH_SDL
+    // Fonts and the software renderer need no video device
+    if (TTF_Init()) {
+        BenchSetText(options, results);
+        BenchRenderSubmit(options, results);
+        TTF_Quit();
+    } else {
+        std::fprintf(stderr, "SDL_ttf could not initialize: %s\n",
+                     SDL_GetError());
+    }
+    BenchParticles(options, results);
+#endif
+
+    std::FILE *out{outPath ? std::fopen(outPath, "w") : stdout};
+    if (out == nullptr) {
+        std::fprintf(stderr, "Could not open %s\n", outPath);
+        return EXIT_FAILURE;
+    }
+    WriteJson(out, options, results);
+    if (out != stdout)
+        std::fclose(out);
+
+    return EXIT_SUCCESS;
+}
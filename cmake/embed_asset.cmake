@@ -0,0 +1,35 @@
+# Turn a file into a C++ source defining it as a byte array, so assets ship
+# inside the executable.
+#
+#   cmake -DINPUT=file -DOUTPUT=file.cpp -DSYMBOL=name -P embed_asset.cmake
+#
+# Defines SdlPong::<SYMBOL> and SdlPong::<SYMBOL>Size.
+
+file(READ "${INPUT}" HEX HEX)
+string(LENGTH "${HEX}" HEX_LENGTH)
+math(EXPR SIZE "${HEX_LENGTH} / 2")
+
+# Sixteen bytes per line
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BYTES "${HEX}")
+string(REPEAT "0x..," 16 LINE)
+string(REGEX REPLACE "(${LINE})" "\\1\n    " BYTES "${BYTES}")
+get_filename_component(NAME "${INPUT}" NAME)
+
+file(WRITE "${OUTPUT}.tmp"
+"// Generated from ${NAME} by embed_asset.cmake, do not edit
+#include <cstddef>
+
+namespace SdlPong {
+
+extern const unsigned char ${SYMBOL}[];
+extern const std::size_t ${SYMBOL}Size;
+
+alignas(16) const unsigned char ${SYMBOL}[] = {
+    ${BYTES}};
+const std::size_t ${SYMBOL}Size{${SIZE}};
+
+} // namespace SdlPong
+")
+# Leave the output untouched when nothing changed, to avoid rebuilds
+configure_file("${OUTPUT}.tmp" "${OUTPUT}" COPYONLY)
+file(REMOVE "${OUTPUT}.tmp")
@@ -0,0 +1,52 @@
+#include "collision.hpp"
+#include "collision_response.hpp"
+#include <algorithm>
+
+/* SdlPong::BroadPhase::FindPairs {{{ */
+const std::vector<SdlPong::CollisionPair> &
+SdlPong::BroadPhase::FindPairs(const EntityStore &entities) {
+    const int n{entities.size()};
+    const int *x{entities.x.data()};
+
+    // Bodies added since the last call join at the end
+    for (Entity e{static_cast<Entity>(mOrder.size())}; e < n; ++e)
+        mOrder.push_back(e);
+
+    // Insertion sort by left edge
+    for (int i{1}; i < n; ++i) {
+        Entity e{mOrder[i]};
+        int j{i - 1};
+        for (; j >= 0 && x[mOrder[j]] > x[e]; --j)
+            mOrder[j + 1] = mOrder[j];
+        mOrder[j + 1] = e;
+    }
+
+    // Sweep: a body stays active until a body starting at or after its right
+    // edge is reached
+    mPairs.clear();
+    mActive.clear();
+    for (Entity e : mOrder) {
+        std::erase_if(mActive, [&](Entity a) {
+            return x[a] + entities.w[a] <= x[e];
+        });
+
+        SdlPong::Rect r{entities.rect(e)};
+        for (Entity a : mActive) {
+            if (SdlPong::IsStatic(entities.id[a]) &&
+                SdlPong::IsStatic(entities.id[e]))
+                continue;
+            SdlPong::Rect other{entities.rect(a)};
+            if (SdlPong::HasIntersection(&r, &other))
+                mPairs.push_back({.a = std::min(a, e), .b = std::max(a, e)});
+        }
+        mActive.push_back(e);
+    }
+
+    // Same order as testing every pair, so collision responses resolve the
+    // same way
+    std::sort(mPairs.begin(), mPairs.end(),
+              [](const CollisionPair &l, const CollisionPair &r) {
+                  return l.a != r.a ? l.a < r.a : l.b < r.b;
+              });
+    return mPairs;
+} /* }}} */
@@ -0,0 +1,35 @@
+#ifndef _JC_COLLISION
+#define _JC_COLLISION
+
+#include "entity_store.hpp"
+#include <vector>
+
+namespace SdlPong {
+
+// Two overlapping bodies, a < b
+struct CollisionPair {
+    Entity a;
+    Entity b;
+};
+
+/* class BroadPhase {{{
+ * Sweep and prune along x. Bodies are kept sorted by their left edge between
+ * calls; since they move little per tick, the insertion sort that restores
+ * the order is close to linear. The sweep then only tests bodies whose x
+ * ranges overlap, instead of every pair.
+ * */
+class BroadPhase {
+  public:
+    // Every overlapping pair of bodies, each reported exactly once and
+    // ordered by (a, b). Pairs of two static bodies are skipped.
+    const std::vector<CollisionPair> &FindPairs(const EntityStore &entities);
+
+  private:
+    std::vector<Entity> mOrder;
+    std::vector<Entity> mActive;
+    std::vector<CollisionPair> mPairs;
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_COLLISION */
@@ -0,0 +1,139 @@
+#ifndef _JC_COLLISION_RESPONSE
+#define _JC_COLLISION_RESPONSE
+
+#include "entity_store.hpp"
+#include <iterator>
+
+// What a body does when it touches another, decided by their two kinds.
+// The rules are a constexpr table checked while compiling: a kind of body
+// that moves must list a response for every kind it can meet, so adding a
+// body kind without deciding how it collides fails the build instead of an
+// assert at run time. Resolving a response is then a table lookup, and
+// applying it an indexed call, with no branching on kinds.
+
+namespace SdlPong {
+
+enum Response {
+    noResponse,     // carries on as if nothing was there
+    scoreResponse,  // ball left the field; Simulation scores the point
+    bounceRight,    // ball off the face of the left bar
+    bounceLeft,     // ball off the face of the right bar
+    bounceVertical, // ball off the top or bottom wall
+    stopBelow,      // bar held under the top wall
+    stopAbove,      // bar held over the bottom wall
+};
+
+constexpr int kNumResponses{stopAbove + 1};
+
+struct BodyKind {
+    Id kind;
+    bool moves; // static bodies respond to nothing
+};
+
+// Every kind of body once, in the order of Id
+inline constexpr BodyKind kBodyKinds[]{
+    {ball, true},
+    {leftBar, true},
+    {rightBar, true},
+    {topWall, false},
+    {bottomWall, false},
+    {leftWall, false},
+    {rightWall, false},
+};
+
+consteval bool ListsEveryKind() {
+    if (std::size(kBodyKinds) != kNumIds)
+        return false;
+    for (int i{0}; i < kNumIds; ++i) {
+        if (kBodyKinds[i].kind != i)
+            return false;
+    }
+    return true;
+}
+
+static_assert(ListsEveryKind(),
+              "kBodyKinds must list every Id once, in the order of Id");
+
+// Whether bodies of this kind never move
+constexpr bool IsStatic(Id kind) { return !kBodyKinds[kind].moves; }
+
+struct CollisionRule {
+    Id self;  // the body that responds
+    Id other; // what it touched
+    Response response;
+};
+
+// Every pair of a moving kind and any kind, exactly once
+inline constexpr CollisionRule kCollisionRules[]{
+    {ball, ball, noResponse},
+    {ball, leftBar, bounceRight},
+    {ball, rightBar, bounceLeft},
+    {ball, topWall, bounceVertical},
+    {ball, bottomWall, bounceVertical},
+    {ball, leftWall, scoreResponse},
+    {ball, rightWall, scoreResponse},
+
+    // The ball bounces off the bars, they are not pushed back
+    {leftBar, ball, noResponse},
+    {leftBar, leftBar, noResponse},
+    {leftBar, rightBar, noResponse},
+    {leftBar, topWall, stopBelow},
+    {leftBar, bottomWall, stopAbove},
+    {leftBar, leftWall, noResponse},
+    {leftBar, rightWall, noResponse},
+
+    {rightBar, ball, noResponse},
+    {rightBar, leftBar, noResponse},
+    {rightBar, rightBar, noResponse},
+    {rightBar, topWall, stopBelow},
+    {rightBar, bottomWall, stopAbove},
+    {rightBar, leftWall, noResponse},
+    {rightBar, rightWall, noResponse},
+};
+
+struct CollisionTable {
+    Response responses[kNumIds][kNumIds]; // [self][other]
+};
+
+/* consteval CollisionTable BuildCollisionTable() {{{
+ * Reaching a throw while compiling is an error, which is what rejects an
+ * incomplete or contradictory rule list.
+ * */
+consteval CollisionTable BuildCollisionTable() {
+    CollisionTable table{};
+    bool listed[kNumIds][kNumIds]{};
+
+    for (const CollisionRule &rule : kCollisionRules) {
+        if (listed[rule.self][rule.other])
+            throw "Collision pair listed twice in kCollisionRules";
+        if (IsStatic(rule.self) && rule.response != noResponse)
+            throw "Static bodies cannot respond to collisions";
+        listed[rule.self][rule.other] = true;
+        table.responses[rule.self][rule.other] = rule.response;
+    }
+
+    for (int self{0}; self < kNumIds; ++self) {
+        for (int other{0}; other < kNumIds; ++other) {
+            if (!IsStatic(static_cast<Id>(self)) && !listed[self][other])
+                throw "Collision pair missing from kCollisionRules";
+        }
+    }
+    return table;
+} /* }}} */
+
+inline constexpr CollisionTable kCollisionTable{BuildCollisionTable()};
+
+constexpr Response CollisionResponse(Id self, Id other) {
+    return kCollisionTable.responses[self][other];
+}
+
+// Whether a body of kind self changes course when it touches a body of kind
+// other. Scoring is not a change of course; Simulation handles it.
+constexpr bool RespondsTo(Id self, Id other) {
+    const Response response{CollisionResponse(self, other)};
+    return response != noResponse && response != scoreResponse;
+}
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_COLLISION_RESPONSE */
@@ -0,0 +1,148 @@
+#include "entity_store.hpp"
+#include "collision_response.hpp"
+#include <array>
+#include <cstddef>
+#include <utility>
+
+bool SdlPong::HasIntersection(const Rect *a, const Rect *b) {
+    if (a->w <= 0 || a->h <= 0 || b->w <= 0 || b->h <= 0)
+        return false;
+    return a->x < b->x + b->w && b->x < a->x + a->w && a->y < b->y + b->h &&
+           b->y < a->y + a->h;
+}
+
+/* SdlPong::Entity SdlPong::EntityStore::add {{{ */
+SdlPong::Entity SdlPong::EntityStore::add(GraphicBox gb, RigidBody rb,
+                                          SdlPong::Id kind) {
+    x.push_back(gb.rect.x);
+    y.push_back(gb.rect.y);
+    w.push_back(gb.rect.w);
+    h.push_back(gb.rect.h);
+    xvel.push_back(rb.xvel);
+    yvel.push_back(rb.yvel);
+    color.push_back(gb.color);
+    id.push_back(kind);
+
+    postX.push_back(0);
+    postY.push_back(0);
+    postXvel.push_back(0);
+    postYvel.push_back(0);
+    collided.push_back(false);
+
+    initX.push_back(gb.rect.x);
+    initY.push_back(gb.rect.y);
+    initXvel.push_back(rb.xvel);
+    initYvel.push_back(rb.yvel);
+
+    return static_cast<Entity>(x.size() - 1);
+} /* }}} */
+
+int SdlPong::EntityStore::size() const { return static_cast<int>(x.size()); }
+
+SdlPong::Rect SdlPong::EntityStore::rect(Entity e) const {
+    return {x[e], y[e], w[e], h[e]};
+}
+
+SdlPong::GraphicBox SdlPong::EntityStore::graphicBox(Entity e) const {
+    return {rect(e), color[e]};
+}
+
+SdlPong::RigidBody SdlPong::EntityStore::vel(Entity e) const {
+    return {xvel[e], yvel[e]};
+}
+
+void SdlPong::EntityStore::setVel(Entity e, RigidBody rb) {
+    xvel[e] = rb.xvel;
+    yvel[e] = rb.yvel;
+}
+
+void SdlPong::EntityStore::reset(Entity e) {
+    x[e] = initX[e];
+    y[e] = initY[e];
+    xvel[e] = initXvel[e];
+    yvel[e] = initYvel[e];
+    collided[e] = false;
+}
+
+void SdlPong::EntityStore::UpdatePositions() {
+    const int n{size()};
+    for (int i{0}; i < n; ++i) {
+        x[i] += xvel[i];
+        y[i] += yvel[i];
+    }
+}
+
+namespace {
+
+/* template <SdlPong::Response R> void Respond {{{
+ * Sets the pending state of e, already holding its current one, for response
+ * R against other. One instance per response, so the response itself is
+ * never tested at run time.
+ * */
+template <SdlPong::Response R>
+void Respond(SdlPong::EntityStore &es, SdlPong::Entity e,
+             SdlPong::Entity other) {
+    if constexpr (R == SdlPong::bounceRight) {
+        // Only setting post_vel to -vel may cause the ball to get stuck in
+        // the bar if it clipped too much
+        es.postXvel[e] = es.postXvel[e] < 0 ? -es.postXvel[e] : es.postXvel[e];
+        es.postYvel[e] = es.yvel[other];
+    } else if constexpr (R == SdlPong::bounceLeft) {
+        es.postXvel[e] = es.postXvel[e] > 0 ? -es.postXvel[e] : es.postXvel[e];
+        es.postYvel[e] = es.yvel[other];
+    } else if constexpr (R == SdlPong::bounceVertical) {
+        es.postYvel[e] = -es.postYvel[e];
+    } else if constexpr (R == SdlPong::stopBelow) {
+        es.postYvel[e] = 0;
+        es.postY[e] = es.y[other] + es.h[other];
+    } else if constexpr (R == SdlPong::stopAbove) {
+        es.postYvel[e] = 0;
+        es.postY[e] = es.y[other] - es.h[e];
+    } else {
+        // Any other response that changes course needs a branch above
+        static_assert(R == SdlPong::noResponse || R == SdlPong::scoreResponse,
+                      "Collision response without a handler");
+    }
+} /* }}} */
+
+using RespondFn = void (*)(SdlPong::EntityStore &, SdlPong::Entity,
+                           SdlPong::Entity);
+
+template <std::size_t... Rs>
+constexpr std::array<RespondFn, sizeof...(Rs)>
+MakeResponders(std::index_sequence<Rs...>) {
+    return {&Respond<static_cast<SdlPong::Response>(Rs)>...};
+}
+
+// Indexed by SdlPong::Response
+constexpr auto kResponders{
+    MakeResponders(std::make_index_sequence<SdlPong::kNumResponses>{})};
+
+} // namespace
+
+/*void SdlPong::EntityStore::RegisterCollision(Entity e, Entity other) {{{
+ * Figure out the position and velocity after collision.
+ * Does not update them yet in order for other bodies to register collisions.
+ * */
+void SdlPong::EntityStore::RegisterCollision(Entity e, Entity other) {
+    collided[e] = true;
+    postX[e] = x[e];
+    postY[e] = y[e];
+    postXvel[e] = xvel[e];
+    postYvel[e] = yvel[e];
+
+    kResponders[SdlPong::CollisionResponse(id[e], id[other])](*this, e, other);
+} /* }}} */
+
+void SdlPong::EntityStore::HandleCollisions() {
+    const int n{size()};
+    for (int i{0}; i < n; ++i) {
+        if (collided[i]) {
+            x[i] = postX[i];
+            y[i] = postY[i];
+            xvel[i] = postXvel[i];
+            yvel[i] = postYvel[i];
+            collided[i] = false;
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef _JC_ENTITY_STORE
+#define _JC_ENTITY_STORE
+
+#include <cstdint>
+#include <vector>
+
+namespace SdlPong {
+
+enum Side {
+    left,
+    right,
+};
+
+enum BarDirection { up, down, none };
+
+enum Id {
+    ball,
+    leftBar,
+    rightBar,
+    topWall,
+    bottomWall,
+    leftWall,
+    rightWall,
+};
+
+// Number of body kinds
+constexpr int kNumIds{rightWall + 1};
+
+// Tick rate the original frame-locked game was tuned for
+constexpr int kBaseTickRate{60};
+
+// Bodies of a match keep positions, sizes and velocities in Q16.16 world
+// units, see fixed_point.hpp
+struct Rect {
+    int x;
+    int y;
+    int w;
+    int h;
+};
+
+struct Color {
+    std::uint8_t r;
+    std::uint8_t g;
+    std::uint8_t b;
+    std::uint8_t a;
+};
+
+struct GraphicBox {
+    Rect rect; // size and position
+    Color color;
+};
+
+struct RigidBody { // velocity
+    int xvel;
+    int yvel;
+};
+
+// Same semantics as SDL_HasRectIntersection: empty rects never intersect
+bool HasIntersection(const Rect *a, const Rect *b);
+
+// Index of a body in an EntityStore
+using Entity = int;
+
+/* struct EntityStore {{{
+ * Structure-of-arrays storage for every body in a match. Each field lives in
+ * its own contiguous array indexed by Entity, so the per-tick passes below
+ * are linear sweeps over packed data.
+ * */
+struct EntityStore {
+    Entity add(GraphicBox gb, RigidBody rb, Id kind);
+    int size() const;
+
+    Rect rect(Entity e) const;
+    GraphicBox graphicBox(Entity e) const;
+    RigidBody vel(Entity e) const;
+    void setVel(Entity e, RigidBody rb);
+    void reset(Entity e);
+
+    // Move every body by its velocity
+    void UpdatePositions();
+    // Figure out the position and velocity of e after colliding with other,
+    // as kCollisionRules in collision_response.hpp says. Does not update them
+    // yet in order for other bodies to register collisions.
+    void RegisterCollision(Entity e, Entity other);
+    // Apply every registered collision response
+    void HandleCollisions();
+
+    // Current state
+    std::vector<int> x;
+    std::vector<int> y;
+    std::vector<int> w;
+    std::vector<int> h;
+    std::vector<int> xvel;
+    std::vector<int> yvel;
+    std::vector<Color> color;
+    std::vector<Id> id;
+
+    // Pending collision response
+    std::vector<int> postX;
+    std::vector<int> postY;
+    std::vector<int> postXvel;
+    std::vector<int> postYvel;
+    std::vector<std::uint8_t> collided;
+
+    // Reset templates
+    std::vector<int> initX;
+    std::vector<int> initY;
+    std::vector<int> initXvel;
+    std::vector<int> initYvel;
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_ENTITY_STORE */
@@ -0,0 +1,137 @@
+#include "match_farm.hpp"
+#include "mlp_policy.hpp"
+#include "paddle_policy.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Round-robin tournament between the built-in paddle policies
+
+namespace {
+
+constexpr const char *kOptions[]{"--matches",   "--threads", "--points",
+                                 "--tick-rate", "--seed",    "--mlp",
+                                 "--dataset"};
+
+bool IsOption(const char *arg) {
+    for (const char *option : kOptions) {
+        if (std::strcmp(arg, option) == 0)
+            return true;
+    }
+    return false;
+}
+
+void PrintUsage(const char *program) {
+    std::fprintf(stderr,
+                 "Usage: %s [--matches N] [--threads N] [--points N]\n"
+                 "       [--tick-rate N] [--seed N] [--mlp MODEL]"
+                 " [--dataset FILE]\n",
+                 program);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    SdlPong::FarmConfig config;
+    // Trained network to enter, in float and int8
+    const char *mlpPath{nullptr};
+    // Trajectory file recording every match
+    const char *datasetPath{nullptr};
+
+    // Every option takes a value
+    for (int i{1}; i < argc; i += 2) {
+        const char *option{argv[i]};
+        const char *value{argv[i + 1]}; // argv[argc] is null
+        if (!IsOption(option)) {
+            std::fprintf(stderr, "Unknown option %s\n", option);
+            PrintUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        if (value == nullptr) {
+            std::fprintf(stderr, "Missing value for %s\n", option);
+            PrintUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (std::strcmp(option, "--matches") == 0)
+            config.matchesPerPairing = std::atoi(value);
+        else if (std::strcmp(option, "--threads") == 0)
+            config.numThreads = std::atoi(value);
+        else if (std::strcmp(option, "--points") == 0)
+            config.pointsToWin = std::atoi(value);
+        else if (std::strcmp(option, "--tick-rate") == 0)
+            config.tickRate = std::atoi(value);
+        else if (std::strcmp(option, "--seed") == 0)
+            config.seed = static_cast<std::uint32_t>(std::atoi(value));
+        else if (std::strcmp(option, "--mlp") == 0)
+            mlpPath = value;
+        else
+            datasetPath = value;
+    }
+    if (config.matchesPerPairing < 0 || config.pointsToWin <= 0 ||
+        config.tickRate <= 0) {
+        std::fprintf(stderr, "Invalid options\n");
+        return EXIT_FAILURE;
+    }
+    config.maxTicks = config.tickRate * 60 * 10;
+
+    SdlPong::MatchFarm farm{config};
+
+    // Half a bar's height, the bar stops once the ball is within it
+    const int deadZone{SdlPong::ToFixed(SdlPong::kWorldHeight) / 12};
+
+    farm.addPolicy("tracking", [](std::uint32_t seed) {
+        return std::make_unique<SdlPong::TrackingPolicy>(0, 0.0, seed);
+    });
+    farm.addPolicy("tracking-deadzone", [deadZone](std::uint32_t seed) {
+        return std::make_unique<SdlPong::TrackingPolicy>(deadZone, 0.0, seed);
+    });
+    farm.addPolicy("tracking-sloppy", [](std::uint32_t seed) {
+        return std::make_unique<SdlPong::TrackingPolicy>(0, 0.3, seed);
+    });
+    farm.addPolicy("intercept-easy", [](std::uint32_t seed) {
+        return std::make_unique<SdlPong::InterceptPolicy>(SdlPong::easyAI,
+                                                          seed);
+    });
+    farm.addPolicy("intercept-hard", [](std::uint32_t seed) {
+        return std::make_unique<SdlPong::InterceptPolicy>(SdlPong::hardAI,
+                                                          seed);
+    });
+    farm.addPolicy("idle", [](std::uint32_t) {
+        return std::make_unique<SdlPong::IdlePolicy>();
+    });
+
+    if (mlpPath != nullptr) {
+        auto net{std::make_shared<SdlPong::Mlp>()};
+        if (!net->load(mlpPath) ||
+            net->getInputSize() != SdlPong::kObservationSize ||
+            net->getOutputSize() != SdlPong::kNumMlpActions) {
+            std::fprintf(stderr, "Could not load %s\n", mlpPath);
+            return EXIT_FAILURE;
+        }
+        farm.addPolicy("mlp", [net](std::uint32_t) {
+            return std::make_unique<SdlPong::MlpPolicy>(net);
+        });
+        farm.addPolicy("mlp-int8", [net](std::uint32_t) {
+            return std::make_unique<SdlPong::MlpPolicy>(net, true);
+        });
+    }
+
+    std::unique_ptr<SdlPong::TrajectoryWriter> dataset;
+    if (datasetPath != nullptr) {
+        dataset = std::make_unique<SdlPong::TrajectoryWriter>(
+            datasetPath, config.tickRate);
+        farm.setDataset(dataset.get());
+    }
+
+    farm.run();
+    farm.report(std::cout);
+
+    if (dataset && !dataset->close()) {
+        std::fprintf(stderr, "Could not write %s\n", datasetPath);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
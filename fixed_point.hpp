@@ -0,0 +1,48 @@
+#ifndef _JC_FIXED_POINT
+#define _JC_FIXED_POINT
+
+#include <cstdint>
+
+// Units of the simulation. Positions, sizes and velocities are Q16.16
+// fixed-point world units kept in plain ints. The field is always
+// kWorldWidth by kWorldHeight units whatever the window size, and every rule
+// is integer arithmetic, so a match plays out bit for bit the same on every
+// machine and compiler. Only rendering converts to pixels.
+
+namespace SdlPong {
+
+using Fixed = std::int32_t;
+
+constexpr int kFixedShift{16};
+constexpr Fixed kFixedOne{1 << kFixedShift};
+
+// Size of the playing field in whole world units. A Fixed holds up to
+// 32767 units, which leaves room for bodies outside the field.
+constexpr int kWorldWidth{640};
+constexpr int kWorldHeight{480};
+
+constexpr Fixed ToFixed(int units) { return units * kFixedOne; }
+
+// a * num / den, rounded towards zero, without overflowing in between
+constexpr Fixed FixedScale(Fixed a, std::int64_t num, std::int64_t den) {
+    return static_cast<Fixed>(a * num / den);
+}
+
+// Products and quotients of two fixed-point numbers, rounded towards zero
+constexpr Fixed FixedMul(Fixed a, Fixed b) {
+    return FixedScale(a, b, kFixedOne);
+}
+constexpr Fixed FixedDiv(Fixed a, Fixed b) {
+    return FixedScale(a, kFixedOne, b);
+}
+
+// Whole units, rounded down
+constexpr int FixedFloor(Fixed a) { return a >> kFixedShift; }
+
+constexpr float FixedToFloat(Fixed a) {
+    return static_cast<float>(a) * (1.0f / kFixedOne);
+}
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_FIXED_POINT */
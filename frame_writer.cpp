@@ -0,0 +1,151 @@
+#include "frame_writer.hpp"
+#include <cassert>
+
+/* SdlPong::FrameWriter::FrameWriter {{{ */
+SdlPong::FrameWriter::FrameWriter(const std::string &path,
+                                  CaptureFormat format, int width, int height,
+                                  int fps, int numBuffers)
+    : mFile{path == "-" ? stdout : std::fopen(path.c_str(), "wb")},
+      mOwnsFile{path != "-"}, mFormat{format}, mWidth{width},
+      mHeight{height} {
+
+    assert(numBuffers > 0 && "FrameWriter needs at least one buffer");
+
+    if (mFile == nullptr) {
+        mFailed = true;
+        return;
+    }
+
+    mBuffers.assign(numBuffers,
+                    std::vector<std::uint8_t>(std::size_t(width) * height * 4));
+    if (mFormat == CaptureFormat::y4m) {
+        mConverted.resize(std::size_t(width) * height * 3);
+        std::fprintf(mFile, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width,
+                     height, fps);
+    }
+
+    mThread = std::thread{[this] { run(); }};
+}
+/* }}} */
+
+SdlPong::FrameWriter::~FrameWriter() {
+    if (mThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock{mMutex};
+            mStopping = true;
+        }
+        mFilled.notify_one();
+        mThread.join();
+    }
+    if (mFile != nullptr && mOwnsFile)
+        std::fclose(mFile);
+    else if (mFile != nullptr)
+        std::fflush(mFile);
+}
+
+std::uint8_t *SdlPong::FrameWriter::acquire() {
+    std::unique_lock<std::mutex> lock{mMutex};
+    assert(!mAcquired && "Submit the previous frame first");
+    mFreed.wait(lock, [this] {
+        return mQueued < static_cast<int>(mBuffers.size());
+    });
+    mAcquired = true;
+    return mBuffers[mHead].data();
+}
+
+void SdlPong::FrameWriter::submit() {
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        assert(mAcquired && "Acquire a frame first");
+        mAcquired = false;
+        mHead = (mHead + 1) % static_cast<int>(mBuffers.size());
+        ++mQueued;
+    }
+    mFilled.notify_one();
+}
+
+bool SdlPong::FrameWriter::ok() const { return !mFailed; }
+
+/* void SdlPong::FrameWriter::run() {{{ */
+void SdlPong::FrameWriter::run() {
+    while (true) {
+        const std::uint8_t *frame;
+        {
+            std::unique_lock<std::mutex> lock{mMutex};
+            mFilled.wait(lock, [this] { return mQueued > 0 || mStopping; });
+            if (mQueued == 0)
+                return; // stopping and drained
+            frame = mBuffers[mTail].data();
+        }
+
+        // The game cannot touch this buffer until it is released below
+        writeFrame(frame);
+
+        {
+            std::lock_guard<std::mutex> lock{mMutex};
+            mTail = (mTail + 1) % static_cast<int>(mBuffers.size());
+            --mQueued;
+        }
+        mFreed.notify_one();
+    }
+} /* }}} */
+
+/* void SdlPong::FrameWriter::writeFrame(const std::uint8_t *rgba) {{{ */
+void SdlPong::FrameWriter::writeFrame(const std::uint8_t *rgba) {
+    if (mFailed)
+        return;
+
+    const std::size_t numPixels{std::size_t(mWidth) * mHeight};
+    std::size_t written{0};
+    std::size_t expected{0};
+
+    switch (mFormat) {
+    case CaptureFormat::y4m: {
+        // BT.601 studio swing, in integer math; planes Y, then U, then V
+        std::uint8_t *yPlane{mConverted.data()};
+        std::uint8_t *uPlane{yPlane + numPixels};
+        std::uint8_t *vPlane{uPlane + numPixels};
+        for (std::size_t i{0}; i < numPixels; ++i) {
+            const int r{rgba[4 * i]};
+            const int g{rgba[4 * i + 1]};
+            const int b{rgba[4 * i + 2]};
+            yPlane[i] = static_cast<std::uint8_t>(
+                ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            uPlane[i] = static_cast<std::uint8_t>(
+                ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            vPlane[i] = static_cast<std::uint8_t>(
+                ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+        std::fputs("FRAME\n", mFile);
+        expected = mConverted.size();
+        written = std::fwrite(mConverted.data(), 1, expected, mFile);
+        break;
+    }
+    case CaptureFormat::ppm: {
+        std::fprintf(mFile, "P6\n%d %d\n255\n", mWidth, mHeight);
+        // Drop alpha in place of a second buffer; one row at a time
+        std::uint8_t row[3 * 4096];
+        for (int y{0}; y < mHeight; ++y) {
+            const std::uint8_t *src{rgba + std::size_t(y) * mWidth * 4};
+            for (int x0{0}; x0 < mWidth; x0 += 4096) {
+                const int n{mWidth - x0 < 4096 ? mWidth - x0 : 4096};
+                for (int x{0}; x < n; ++x) {
+                    row[3 * x] = src[4 * (x0 + x)];
+                    row[3 * x + 1] = src[4 * (x0 + x) + 1];
+                    row[3 * x + 2] = src[4 * (x0 + x) + 2];
+                }
+                expected += 3 * std::size_t(n);
+                written += std::fwrite(row, 1, 3 * std::size_t(n), mFile);
+            }
+        }
+        break;
+    }
+    case CaptureFormat::rgba:
+        expected = numPixels * 4;
+        written = std::fwrite(rgba, 1, expected, mFile);
+        break;
+    }
+
+    if (written != expected)
+        mFailed = true;
+} /* }}} */
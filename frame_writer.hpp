@@ -0,0 +1,75 @@
+#ifndef _JC_FRAME_WRITER
+#define _JC_FRAME_WRITER
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SdlPong {
+
+enum class CaptureFormat {
+    y4m,  // YUV4MPEG2, 4:4:4, readable by ffmpeg and most players
+    ppm,  // concatenated binary PPM images
+    rgba, // raw 8-bit RGBA
+};
+
+/* class FrameWriter {{{
+ * Streams RGBA frames to a file on a background thread. Frames go through a
+ * bounded ring of buffers that are allocated once: the game fills a free
+ * buffer with acquire()/submit() and only waits when the writer has fallen
+ * a whole ring behind. Color conversion and I/O happen on the writer
+ * thread.
+ * */
+class FrameWriter {
+  public:
+    // path "-" writes to stdout
+    FrameWriter(const std::string &path, CaptureFormat format, int width,
+                int height, int fps, int numBuffers = 4);
+    // Writes every submitted frame before returning
+    ~FrameWriter();
+
+    FrameWriter(const FrameWriter &) = delete;
+    FrameWriter &operator=(const FrameWriter &) = delete;
+
+    // A buffer of width * height * 4 bytes to fill with the next frame
+    std::uint8_t *acquire();
+    // Queue the acquired buffer for writing
+    void submit();
+
+    // False once the file could not be opened or written
+    bool ok() const;
+
+  private:
+    void run();
+    void writeFrame(const std::uint8_t *rgba);
+
+    std::FILE *mFile;
+    bool mOwnsFile;
+    CaptureFormat mFormat;
+    int mWidth;
+    int mHeight;
+
+    std::vector<std::vector<std::uint8_t>> mBuffers;
+    std::vector<std::uint8_t> mConverted; // writer thread only
+
+    std::mutex mMutex;
+    std::condition_variable mFilled;
+    std::condition_variable mFreed;
+    int mHead{0};  // next buffer handed to the game
+    int mTail{0};  // next buffer to write
+    int mQueued{0}; // submitted, not yet written
+    bool mAcquired{false};
+    bool mStopping{false};
+    std::atomic<bool> mFailed{false};
+
+    std::thread mThread;
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_FRAME_WRITER */
@@ -2,13 +2,33 @@
 #include "SDL3/SDL_log.h"
 #include <SDL3/SDL_keycode.h>
 #define SDL_MAIN_USE_CALLBACKS 1 /* use the callbacks instead of main() */
+#include "mlp_policy.hpp"
 #include "sdl_pong.hpp"
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 
 constexpr int screenWidth{640};
 constexpr int screenHeight{480};
 
+// Offscreen capture: frames per second of the output and how many to write
+constexpr int captureFPS{60};
+static int captureFrames{600};
+
+// How far the arrow keys seek in a replay
+constexpr int replaySeekSeconds{5};
+
+// Chrome trace of the frame profiler, written on quit
+static const char *profilePath{nullptr};
+
+// Draw every frame at the display's rate even when nothing changes, instead
+// of waiting for events while idle
+static bool alwaysRender{false};
+// SDL_AppIterate only runs after events
+static bool waitingForEvents{false};
+
 // From SDL3 examples
 static const struct {
     const char *key;
@@ -41,13 +61,178 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
         return SDL_APP_FAILURE;
     }
 
-    SdlPong::AppState *as = new SdlPong::AppState(screenWidth, screenHeight);
+    // Simulation ticks per second, independent of the display refresh rate
+    int tickRate{SdlPong::kBaseTickRate};
+    // Render an AI match offscreen to this file instead of opening a window
+    const char *capturePath{nullptr};
+    // Record the match to a replay file, or play one back
+    const char *recordPath{nullptr};
+    const char *replayPath{nullptr};
+    // Rollback netplay against a second sdl_pong
+    const char *netplaySide{nullptr};
+    const char *peerHost{"127.0.0.1"};
+    int netplayPort{27960};
+    // Play on a pong_server instead, against another player or its AI
+    const char *serverHost{nullptr};
+    int serverPort{27970};
+    SdlPong::Opponent serverOpponent{SdlPong::humanOpponent};
+    // Log the time from each key press to the frame that shows it
+    bool measureLatency{false};
+    // Step the simulation in the frame loop instead of on its own thread
+    bool singleThread{false};
+    // One-player opponent: easy, normal, hard, perfect or classic, the
+    // original ball chaser
+    const char *aiLevel{"normal"};
+    // Trained network to play the one-player opponent instead
+    const char *aiWeightsPath{nullptr};
+    SdlPong::CaptureFormat captureFormat{SdlPong::CaptureFormat::y4m};
+    for (i = 1; i < argc; i++) {
+        // Options without a value
+        if (std::strcmp(argv[i], "--measure-latency") == 0) {
+            measureLatency = true;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--single-thread") == 0) {
+            singleThread = true;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--always-render") == 0) {
+            alwaysRender = true;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--server-ai") == 0) {
+            serverOpponent = SdlPong::serverOpponent;
+            continue;
+        }
+        if (i + 1 == argc)
+            break;
+
+        if (std::strcmp(argv[i], "--tick-rate") == 0)
+            tickRate = std::atoi(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--capture") == 0)
+            capturePath = argv[i + 1];
+        else if (std::strcmp(argv[i], "--record") == 0)
+            recordPath = argv[i + 1];
+        else if (std::strcmp(argv[i], "--replay") == 0)
+            replayPath = argv[i + 1];
+        else if (std::strcmp(argv[i], "--netplay") == 0)
+            netplaySide = argv[i + 1];
+        else if (std::strcmp(argv[i], "--peer") == 0)
+            peerHost = argv[i + 1];
+        else if (std::strcmp(argv[i], "--port") == 0)
+            netplayPort = std::atoi(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--connect") == 0)
+            serverHost = argv[i + 1];
+        else if (std::strcmp(argv[i], "--server-port") == 0)
+            serverPort = std::atoi(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--profile") == 0)
+            profilePath = argv[i + 1];
+        else if (std::strcmp(argv[i], "--ai") == 0)
+            aiLevel = argv[i + 1];
+        else if (std::strcmp(argv[i], "--ai-weights") == 0)
+            aiWeightsPath = argv[i + 1];
+        else if (std::strcmp(argv[i], "--frames") == 0)
+            captureFrames = std::atoi(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--capture-format") == 0) {
+            if (std::strcmp(argv[i + 1], "y4m") == 0)
+                captureFormat = SdlPong::CaptureFormat::y4m;
+            else if (std::strcmp(argv[i + 1], "ppm") == 0)
+                captureFormat = SdlPong::CaptureFormat::ppm;
+            else if (std::strcmp(argv[i + 1], "rgba") == 0)
+                captureFormat = SdlPong::CaptureFormat::rgba;
+            else {
+                SDL_Log("Unknown capture format %s\n", argv[i + 1]);
+                return SDL_APP_FAILURE;
+            }
+        }
+    }
+    if (tickRate <= 0) {
+        SDL_Log("Invalid tick rate %d\n", tickRate);
+        return SDL_APP_FAILURE;
+    }
+
+    SdlPong::AppState *as =
+        new SdlPong::AppState(screenWidth, screenHeight, tickRate);
     if (!as) {
         return SDL_APP_FAILURE;
     } else {
         *appstate = as;
     }
 
+    as->setMeasureLatency(measureLatency);
+
+    static const struct {
+        const char *name;
+        SdlPong::AILevel level;
+    } aiLevels[] = {{"easy", SdlPong::easyAI},
+                    {"normal", SdlPong::normalAI},
+                    {"hard", SdlPong::hardAI},
+                    {"perfect", SdlPong::perfectAI}};
+    if (aiWeightsPath != nullptr) {
+        auto net{std::make_shared<SdlPong::Mlp>()};
+        if (!net->load(aiWeightsPath) ||
+            net->getInputSize() != SdlPong::kObservationSize ||
+            net->getOutputSize() != SdlPong::kNumMlpActions) {
+            SDL_Log("Could not load AI weights %s\n", aiWeightsPath);
+            return SDL_APP_FAILURE;
+        }
+        as->setAIPolicy(std::make_unique<SdlPong::MlpPolicy>(net));
+    } else if (std::strcmp(aiLevel, "classic") != 0) {
+        const SdlPong::AILevel *level{nullptr};
+        for (const auto &entry : aiLevels) {
+            if (std::strcmp(entry.name, aiLevel) == 0)
+                level = &entry.level;
+        }
+        if (level == nullptr) {
+            SDL_Log("Unknown AI level %s\n", aiLevel);
+            return SDL_APP_FAILURE;
+        }
+        as->setAIPolicy(std::make_unique<SdlPong::InterceptPolicy>(
+            *level, static_cast<std::uint32_t>(SDL_GetTicksNS())));
+    }
+
+    if (replayPath != nullptr && !as->StartReplay(replayPath))
+        return SDL_APP_FAILURE;
+
+    if (netplaySide != nullptr) {
+        SdlPong::Side side;
+        if (std::strcmp(netplaySide, "left") == 0) {
+            side = SdlPong::left;
+        } else if (std::strcmp(netplaySide, "right") == 0) {
+            side = SdlPong::right;
+        } else {
+            SDL_Log("Unknown netplay side %s, use left or right\n",
+                    netplaySide);
+            return SDL_APP_FAILURE;
+        }
+        if (!as->StartNetplay(side, peerHost, netplayPort))
+            return SDL_APP_FAILURE;
+    } else if (serverHost != nullptr &&
+               !as->JoinServer(serverHost, serverPort, serverOpponent)) {
+        return SDL_APP_FAILURE;
+    }
+
+    if (capturePath != nullptr) {
+        // No video subsystem; events are still needed to quit on a signal
+        if (!SDL_Init(SDL_INIT_EVENTS))
+            return SDL_APP_FAILURE;
+        if (!as->StartCapture(capturePath, captureFormat, captureFPS))
+            return SDL_APP_FAILURE;
+        if (!as->isReplaying()) {
+            as->setRightPolicy(std::make_unique<SdlPong::TrackingPolicy>());
+            if (recordPath != nullptr)
+                as->StartRecording(recordPath);
+            as->startGame(true);
+        }
+        return SDL_APP_CONTINUE;
+    }
+
+    // Rollbacks rewrite past ticks and server matches are not simulated
+    // here, so neither is recorded
+    if (recordPath != nullptr && !as->isReplaying() &&
+        netplaySide == nullptr && serverHost == nullptr)
+        as->StartRecording(recordPath);
+
     if (!SDL_Init(SDL_INIT_VIDEO)) {
         return SDL_APP_FAILURE;
     }
@@ -57,52 +242,105 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     }
     SDL_SetRenderVSync(as->mRenderer, true);
 
+    // Only local play moves to the thread; see AppState::StartSimThread
+    if (!singleThread)
+        as->StartSimThread();
+
     return SDL_APP_CONTINUE;
 }
 
 SDL_AppResult SDL_AppIterate(void *appstate) {
     SdlPong::AppState *as = static_cast<SdlPong::AppState *>(appstate);
 
-    as->UpdatePositions();
-    as->CheckCollisions();
-    as->ProcessCollisions();
-    as->Render();
+    as->getProfiler().beginFrame();
+    SdlPong::ProfileScope frame{&as->getProfiler(), SdlPong::framePhase};
+
+    if (as->isCapturing()) {
+        // Offscreen time advances by exactly one output frame per iteration
+        Uint64 frame{static_cast<Uint64>(as->getCapturedFrames()) + 1};
+        as->Update(frame * SDL_NS_PER_SECOND / captureFPS);
+        as->Render();
+        if (!as->captureOk())
+            return SDL_APP_FAILURE;
+        if (as->isReplayFinished())
+            return SDL_APP_SUCCESS;
+        return as->getCapturedFrames() < captureFrames ? SDL_APP_CONTINUE
+                                                       : SDL_APP_SUCCESS;
+    }
+
+    const Uint64 nowNS{SDL_GetTicksNS()};
+    as->Update(nowNS);
+
+    // While idle, present only frames that differ from the last one and let
+    // SDL block until the next event instead of iterating every vsync
+    const bool idle{!alwaysRender && as->isIdle(nowNS)};
+    if (!idle || as->isDirty())
+        as->Render();
+    if (idle != waitingForEvents) {
+        if (idle)
+            SDL_SetHint(SDL_HINT_MAIN_CALLBACK_RATE, "waitevent");
+        else
+            SDL_ResetHint(SDL_HINT_MAIN_CALLBACK_RATE);
+        waitingForEvents = idle;
+    }
 
     return SDL_APP_CONTINUE;
 }
 
+// Which bar key sym is; false if it is not one
+static bool ToInputKey(SDL_Keycode sym, SdlPong::InputKey &key) {
+    switch (sym) {
+    case SDLK_W:
+        key = SdlPong::leftUpKey;
+        return true;
+    case SDLK_S:
+        key = SdlPong::leftDownKey;
+        return true;
+    case SDLK_UP:
+        key = SdlPong::rightUpKey;
+        return true;
+    case SDLK_DOWN:
+        key = SdlPong::rightDownKey;
+        return true;
+    }
+    return false;
+}
+
 SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
     SdlPong::AppState *as = static_cast<SdlPong::AppState *>(appstate);
+    // Keys may start something and window changes may need a redraw; mouse
+    // motion and the like leave an idle loop asleep
+    if (event->type == SDL_EVENT_KEY_DOWN || event->type == SDL_EVENT_KEY_UP ||
+        (event->type >= SDL_EVENT_WINDOW_FIRST &&
+         event->type <= SDL_EVENT_WINDOW_LAST))
+        as->Wake(SDL_GetTicksNS());
     switch (event->type) {
     case SDL_EVENT_QUIT:
         return SDL_APP_SUCCESS;
         break;
     case SDL_EVENT_KEY_DOWN: {
         SDL_Keycode sym = event->key.key;
-        if (sym == SDLK_W)
-            as->moveBar(SdlPong::left, SdlPong::up);
-        if (sym == SDLK_S)
-            as->moveBar(SdlPong::left, SdlPong::down);
-        if (sym == SDLK_UP)
-            as->moveBar(SdlPong::right, SdlPong::up);
-        if (sym == SDLK_DOWN)
-            as->moveBar(SdlPong::right, SdlPong::down);
+        SdlPong::InputKey key;
+        // Bar keys are applied to the tick in which they were pressed
+        if (ToInputKey(sym, key) && !event->key.repeat)
+            as->KeyEvent(key, true, event->key.timestamp);
         if (sym == SDLK_SPACE)
             as->startGame(false);
         if (sym == SDLK_RETURN)
             as->startGame(true);
+        if (sym == SDLK_LEFT)
+            as->SeekReplay(-replaySeekSeconds);
+        if (sym == SDLK_RIGHT)
+            as->SeekReplay(replaySeekSeconds);
+        if (sym == SDLK_F3)
+            as->ToggleProfilerOverlay();
         break;
     }
     case SDL_EVENT_KEY_UP: {
         SDL_Keycode sym = event->key.key;
-        if (sym == SDLK_W)
-            as->moveBar(SdlPong::left, SdlPong::none);
-        if (sym == SDLK_S)
-            as->moveBar(SdlPong::left, SdlPong::none);
-        if (sym == SDLK_UP)
-            as->moveBar(SdlPong::right, SdlPong::none);
-        if (sym == SDLK_DOWN)
-            as->moveBar(SdlPong::right, SdlPong::none);
+        SdlPong::InputKey key;
+        if (ToInputKey(sym, key))
+            as->KeyEvent(key, false, event->key.timestamp);
         break;
     }
     }
@@ -112,6 +350,12 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
 void SDL_AppQuit(void *appstate, SDL_AppResult result) {
 
     SdlPong::AppState *as = static_cast<SdlPong::AppState *>(appstate);
+    if (as != nullptr) {
+        as->StopRecording();
+        as->ReportLatency();
+        if (profilePath != nullptr)
+            as->WriteProfile(profilePath);
+    }
     delete as;
     TTF_Quit();
 }
@@ -0,0 +1,119 @@
+#include "glyph_atlas.hpp"
+#include "SDL3/SDL_log.h"
+#include <SDL3_ttf/SDL_ttf.h>
+
+/* SdlPong::GlyphAtlas::GlyphAtlas {{{ */
+SdlPong::GlyphAtlas::GlyphAtlas(TTF_Font *font) {
+    if (font == nullptr)
+        return;
+    mHeight = TTF_GetFontHeight(font);
+
+    // Render every glyph in white so text can be tinted with vertex colors
+    constexpr SDL_Color white{0xFF, 0xFF, 0xFF, 0xFF};
+    constexpr int kNumGlyphs{kLastChar - kFirstChar + 1};
+    SDL_Surface *glyphSurfaces[kNumGlyphs]{};
+
+    // Shelf packing: fill rows left to right
+    int penX{0};
+    int penY{0};
+    for (int i{0}; i < kNumGlyphs; ++i) {
+        Uint32 ch{static_cast<Uint32>(kFirstChar + i)};
+        int advance{0};
+        if (!TTF_FontHasGlyph(font, ch) ||
+            !TTF_GetGlyphMetrics(font, ch, nullptr, nullptr, nullptr, nullptr,
+                                 &advance))
+            continue;
+        mGlyphs[i].advance = advance;
+
+        SDL_Surface *surface{TTF_RenderGlyph_Blended(font, ch, white)};
+        if (surface == nullptr)
+            continue; // e.g. space has nothing to draw
+        if (penX + surface->w > kAtlasWidth) {
+            penX = 0;
+            penY += mHeight;
+        }
+        mGlyphs[i].src = {penX, penY, surface->w, surface->h};
+        penX += surface->w + 1;
+        glyphSurfaces[i] = surface;
+    }
+
+    mAtlasHeight = penY + mHeight;
+    if (mSurface = SDL_CreateSurface(kAtlasWidth, mAtlasHeight,
+                                     SDL_PIXELFORMAT_RGBA32);
+        mSurface == nullptr) {
+        SDL_Log("Unable to create glyph atlas! SDL Error: %s\n",
+                SDL_GetError());
+    }
+    for (int i{0}; i < kNumGlyphs; ++i) {
+        if (glyphSurfaces[i] == nullptr)
+            continue;
+        if (mSurface != nullptr) {
+            // Copy the glyph's alpha as is; blending it onto the clear atlas
+            // would darken the edges, and alpha is applied again on drawing
+            SDL_SetSurfaceBlendMode(glyphSurfaces[i], SDL_BLENDMODE_NONE);
+            SDL_BlitSurface(glyphSurfaces[i], nullptr, mSurface,
+                            &mGlyphs[i].src);
+        }
+        SDL_DestroySurface(glyphSurfaces[i]);
+    }
+}
+/* }}} */
+
+SdlPong::GlyphAtlas::~GlyphAtlas() {
+    SDL_DestroySurface(mSurface);
+    SDL_DestroyTexture(mTexture);
+}
+
+const SdlPong::GlyphAtlas::Glyph *SdlPong::GlyphAtlas::find(char c) const {
+    if (c < kFirstChar || c > kLastChar)
+        return nullptr;
+    return &mGlyphs[c - kFirstChar];
+}
+
+int SdlPong::GlyphAtlas::measureWidth(std::string_view text) const {
+    int width{0};
+    for (char c : text) {
+        if (const Glyph *glyph = find(c))
+            width += glyph->advance;
+    }
+    return width;
+}
+
+int SdlPong::GlyphAtlas::getHeight() const { return mHeight; }
+
+/* SDL_Texture *SdlPong::GlyphAtlas::getTexture {{{ */
+SDL_Texture *SdlPong::GlyphAtlas::getTexture(SDL_Renderer *renderer) {
+    if (mTexture == nullptr && mSurface != nullptr) {
+        if (mTexture = SDL_CreateTextureFromSurface(renderer, mSurface);
+            mTexture == nullptr) {
+            SDL_Log("Unable to create glyph atlas texture! SDL Error: %s\n",
+                    SDL_GetError());
+        } else {
+            // The pixels now live in the texture
+            SDL_DestroySurface(mSurface);
+            mSurface = nullptr;
+        }
+    }
+    return mTexture;
+} /* }}} */
+
+/* void SdlPong::GlyphAtlas::LayoutText {{{ */
+void SdlPong::GlyphAtlas::LayoutText(std::string_view text, float x, float y,
+                                     std::vector<GlyphQuad> &quads) const {
+    float penX{x};
+    for (char c : text) {
+        const Glyph *glyph{find(c)};
+        if (glyph == nullptr)
+            continue;
+        if (glyph->src.w > 0) {
+            const float w{static_cast<float>(glyph->src.w)};
+            const float h{static_cast<float>(glyph->src.h)};
+            quads.push_back(
+                {.dst = {penX, y, w, h},
+                 .uv = {static_cast<float>(glyph->src.x) / kAtlasWidth,
+                        static_cast<float>(glyph->src.y) / mAtlasHeight,
+                        w / kAtlasWidth, h / mAtlasHeight}});
+        }
+        penX += glyph->advance;
+    }
+} /* }}} */
@@ -0,0 +1,64 @@
+#ifndef _JC_GLYPH_ATLAS
+#define _JC_GLYPH_ATLAS
+
+#include <SDL3/SDL.h>
+#include <SDL3_ttf/SDL_ttf.h>
+#include <string_view>
+#include <vector>
+
+namespace SdlPong {
+
+// Where one glyph goes on screen and where it is in the atlas, with texture
+// coordinates normalized to the atlas size
+struct GlyphQuad {
+    SDL_FRect dst;
+    SDL_FRect uv;
+};
+
+/* class GlyphAtlas {{{
+ * Every printable ASCII glyph of a font rasterized once into a single
+ * texture. Text is then drawn as textured quads, so changing it costs no
+ * rasterization, allocation or texture upload.
+ * */
+class GlyphAtlas {
+  public:
+    // Rasterizes font, which stays owned by the caller. A null font gives
+    // an empty atlas.
+    explicit GlyphAtlas(TTF_Font *font);
+    ~GlyphAtlas();
+
+    // Size in pixels of text drawn with this atlas
+    int measureWidth(std::string_view text) const;
+    int getHeight() const;
+
+    // Append a quad per visible glyph of text, with its top left corner at
+    // (x, y)
+    void LayoutText(std::string_view text, float x, float y,
+                    std::vector<GlyphQuad> &quads) const;
+
+    // The atlas is uploaded the first time a renderer asks for it
+    SDL_Texture *getTexture(SDL_Renderer *renderer);
+
+  private:
+    static constexpr char kFirstChar{' '};
+    static constexpr char kLastChar{'~'};
+    static constexpr int kAtlasWidth{512};
+
+    struct Glyph {
+        SDL_Rect src; // in the atlas
+        int advance;
+    };
+
+    const Glyph *find(char c) const;
+
+    Glyph mGlyphs[kLastChar - kFirstChar + 1]{};
+    int mHeight{0};
+    int mAtlasHeight{1};
+
+    SDL_Surface *mSurface{nullptr};
+    SDL_Texture *mTexture{nullptr};
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_GLYPH_ATLAS */
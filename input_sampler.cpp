@@ -0,0 +1,52 @@
+#include "input_sampler.hpp"
+
+void SdlPong::InputSampler::KeyEvent(InputKey key, bool pressed,
+                                     std::uint64_t timestampNS) {
+    mEvents.push_back(
+        {.timestampNS = timestampNS, .key = key, .pressed = pressed});
+}
+
+/* SdlPong::Inputs SdlPong::InputSampler::Sample(std::uint64_t endNS) {{{ */
+SdlPong::Inputs SdlPong::InputSampler::Sample(std::uint64_t endNS) {
+    // Keys held at the start of the tick count for all of it
+    bool counts[kNumInputKeys];
+    for (int key{0}; key < kNumInputKeys; ++key)
+        counts[key] = mHeld[key];
+
+    mFirstPressNS = 0;
+    std::size_t consumed{0};
+    for (; consumed < mEvents.size(); ++consumed) {
+        const Event &event{mEvents[consumed]};
+        if (event.timestampNS >= endNS)
+            break;
+
+        if (event.pressed && !mHeld[event.key]) {
+            counts[event.key] = true;
+            mPressOrder[event.key] = mNextOrder++;
+            if (mFirstPressNS == 0)
+                mFirstPressNS = event.timestampNS;
+        }
+        mHeld[event.key] = event.pressed;
+    }
+    mEvents.erase(mEvents.begin(), mEvents.begin() + consumed);
+
+    return {.left = Direction(leftUpKey, leftDownKey, counts),
+            .right = Direction(rightUpKey, rightDownKey, counts)};
+} /* }}} */
+
+std::uint64_t SdlPong::InputSampler::getFirstPressNS() const {
+    return mFirstPressNS;
+}
+
+SdlPong::BarDirection
+SdlPong::InputSampler::Direction(InputKey upKey, InputKey downKey,
+                                 const bool counts[kNumInputKeys]) const {
+    if (counts[upKey] && counts[downKey])
+        return mPressOrder[upKey] > mPressOrder[downKey] ? SdlPong::up
+                                                         : SdlPong::down;
+    if (counts[upKey])
+        return SdlPong::up;
+    if (counts[downKey])
+        return SdlPong::down;
+    return SdlPong::none;
+}
@@ -0,0 +1,60 @@
+#ifndef _JC_INPUT_SAMPLER
+#define _JC_INPUT_SAMPLER
+
+#include "pong_sim.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace SdlPong {
+
+enum InputKey {
+    leftUpKey,
+    leftDownKey,
+    rightUpKey,
+    rightDownKey,
+};
+
+constexpr int kNumInputKeys{rightDownKey + 1};
+
+/* class InputSampler {{{
+ * Turns timestamped key transitions into the Inputs of each tick. Events
+ * are queued and only applied to the tick they happened in, however many
+ * arrive between two frames. A key that goes down at any point during a
+ * tick counts for that tick even if it is released before the tick ends,
+ * so quick taps are never dropped. When both keys of a bar count, the one
+ * pressed last wins.
+ * */
+class InputSampler {
+  public:
+    // In the order SDL delivers them; timestamps on the SDL_GetTicksNS
+    // clock
+    void KeyEvent(InputKey key, bool pressed, std::uint64_t timestampNS);
+
+    // Inputs for the tick that ends at endNS. Consumes every event before
+    // endNS.
+    Inputs Sample(std::uint64_t endNS);
+
+    // Time of the earliest key press consumed by the last Sample, or 0
+    std::uint64_t getFirstPressNS() const;
+
+  private:
+    struct Event {
+        std::uint64_t timestampNS;
+        InputKey key;
+        bool pressed;
+    };
+
+    BarDirection Direction(InputKey upKey, InputKey downKey,
+                           const bool counts[kNumInputKeys]) const;
+
+    std::vector<Event> mEvents; // not yet sampled, oldest first
+    bool mHeld[kNumInputKeys]{};
+    // Order of the latest press of each key, larger is more recent
+    std::uint64_t mPressOrder[kNumInputKeys]{};
+    std::uint64_t mNextOrder{1};
+    std::uint64_t mFirstPressNS{0};
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_INPUT_SAMPLER */
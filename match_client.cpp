@@ -0,0 +1,156 @@
+#include "match_client.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+SdlPong::MatchClient::MatchClient() {
+    std::fill(std::begin(mStateTicks), std::end(mStateTicks), -1);
+}
+
+SdlPong::MatchClient::~MatchClient() {
+    if (mTcpFd >= 0)
+        close(mTcpFd);
+    if (mUdpFd >= 0)
+        close(mUdpFd);
+}
+
+/* bool SdlPong::MatchClient::connect {{{ */
+bool SdlPong::MatchClient::connect(const std::string &host, int port,
+                                   Opponent opponent) {
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_port = htons(static_cast<std::uint16_t>(port));
+    if (inet_pton(AF_INET, host.c_str(), &server.sin_addr) != 1)
+        return false;
+
+    mTcpFd = socket(AF_INET, SOCK_STREAM, 0);
+    mUdpFd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (mTcpFd < 0 || mUdpFd < 0)
+        return false;
+
+    // The UDP socket only talks to the server, on the same port number
+    const auto *address{reinterpret_cast<const sockaddr *>(&server)};
+    if (::connect(mTcpFd, address, sizeof(server)) != 0 ||
+        ::connect(mUdpFd, address, sizeof(server)) != 0)
+        return false;
+
+    int noDelay{1};
+    setsockopt(mTcpFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    const std::uint8_t join[kJoinSize]{joinMessage, opponent};
+    if (send(mTcpFd, join, sizeof(join), MSG_NOSIGNAL) != sizeof(join))
+        return false;
+
+    return fcntl(mTcpFd, F_SETFL, fcntl(mTcpFd, F_GETFL) | O_NONBLOCK) == 0 &&
+           fcntl(mUdpFd, F_SETFL, fcntl(mUdpFd, F_GETFL) | O_NONBLOCK) == 0;
+} /* }}} */
+
+bool SdlPong::MatchClient::poll() {
+    if (mTcpFd < 0)
+        return false;
+    ReadControl();
+    if (mPlaying)
+        ReadStates();
+    return mTcpFd >= 0;
+}
+
+/* void SdlPong::MatchClient::sendInput(BarDirection input) {{{ */
+void SdlPong::MatchClient::sendInput(BarDirection input) {
+    if (!mPlaying || mTcpFd < 0)
+        return;
+
+    std::uint8_t packet[kInputSize];
+    packet[0] = inputMessage;
+    PutInt(packet + 1, mClient);
+    PutInt(packet + 5, mToken);
+    packet[9] = static_cast<std::uint8_t>(input);
+    PutInt(packet + 10, mNewest);
+    // A lost input is covered by the next one
+    send(mUdpFd, packet, sizeof(packet), 0);
+} /* }}} */
+
+bool SdlPong::MatchClient::isConnected() const { return mTcpFd >= 0; }
+
+bool SdlPong::MatchClient::isPlaying() const { return mPlaying; }
+
+SdlPong::Side SdlPong::MatchClient::getSide() const { return mSide; }
+
+int SdlPong::MatchClient::getTickRate() const { return mTickRate; }
+
+int SdlPong::MatchClient::getStateTick() const { return mNewest; }
+
+const SdlPong::SimState &SdlPong::MatchClient::getState() const {
+    return mStates[mNewest < 0 ? 0 : mNewest % kStateHistory];
+}
+
+/* void SdlPong::MatchClient::ReadControl() {{{
+ * The welcome is the only message the server sends over TCP; after it the
+ * connection just has to stay open.
+ * */
+void SdlPong::MatchClient::ReadControl() {
+    while (true) {
+        std::uint8_t scratch[kWelcomeSize];
+        std::uint8_t *to{mPlaying ? scratch : mControl + mControlSize};
+        int room{mPlaying ? kWelcomeSize : kWelcomeSize - mControlSize};
+        ssize_t n{recv(mTcpFd, to, room, 0)};
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (n <= 0) {
+            close(mTcpFd);
+            mTcpFd = -1;
+            return;
+        }
+        if (mPlaying)
+            continue;
+
+        mControlSize += static_cast<int>(n);
+        if (mControlSize < kWelcomeSize)
+            continue;
+        if (mControl[0] != welcomeMessage || mControl[1] > right) {
+            close(mTcpFd);
+            mTcpFd = -1;
+            return;
+        }
+        mSide = static_cast<Side>(mControl[1]);
+        mClient = GetInt(mControl + 2);
+        mToken = GetInt(mControl + 6);
+        mTickRate = GetInt(mControl + 10);
+        mPlaying = true;
+    }
+} /* }}} */
+
+/* void SdlPong::MatchClient::ReadStates() {{{ */
+void SdlPong::MatchClient::ReadStates() {
+    std::uint8_t packet[kStateHeaderSize + kMaxDeltaSize];
+    ssize_t n;
+    while ((n = recv(mUdpFd, packet, sizeof(packet), 0)) >= 0) {
+        if (n < kStateHeaderSize || packet[0] != stateMessage)
+            continue;
+        int tick{GetInt(packet + 1)};
+        int baseTick{GetInt(packet + 5)};
+        // Late or duplicated
+        if (tick <= mNewest || baseTick >= tick)
+            continue;
+
+        SimState base{};
+        if (baseTick >= 0) {
+            // Baselines are always states this client confirmed, so one
+            // that is missing is from before a reordering
+            if (mStateTicks[baseTick % kStateHistory] != baseTick)
+                continue;
+            base = mStates[baseTick % kStateHistory];
+        }
+
+        SimState state;
+        if (!DecodeDelta(base, packet + kStateHeaderSize,
+                         static_cast<int>(n) - kStateHeaderSize, state))
+            continue;
+        mStates[tick % kStateHistory] = state;
+        mStateTicks[tick % kStateHistory] = tick;
+        mNewest = tick;
+    }
+} /* }}} */
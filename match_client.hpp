@@ -0,0 +1,68 @@
+#ifndef _JC_MATCH_CLIENT
+#define _JC_MATCH_CLIENT
+
+#include "match_protocol.hpp"
+#include "pong_sim.hpp"
+#include <cstdint>
+#include <string>
+
+namespace SdlPong {
+
+/* class MatchClient {{{
+ * One player of a match hosted by pong_server. The server runs the
+ * simulation; the client sends its bar input every tick and shows the
+ * newest state it got back. See match_protocol.hpp.
+ * */
+class MatchClient {
+  public:
+    MatchClient();
+    ~MatchClient();
+
+    MatchClient(const MatchClient &) = delete;
+    MatchClient &operator=(const MatchClient &) = delete;
+
+    // Connect to the server at host, a dotted IPv4 address, and ask for a
+    // match. Blocks until the TCP connection is made or refused.
+    bool connect(const std::string &host, int port, Opponent opponent);
+
+    // Take in the welcome and every state that arrived. Returns false once
+    // the server has closed the connection.
+    bool poll();
+    // Send this tick's input; does nothing until the match has started
+    void sendInput(BarDirection input);
+
+    bool isConnected() const;
+    // The server has paired this client and sent its side
+    bool isPlaying() const;
+    Side getSide() const;
+    int getTickRate() const;
+
+    // Server tick of the newest state, or -1 before the first arrives
+    int getStateTick() const;
+    const SimState &getState() const;
+
+  private:
+    void ReadControl();
+    void ReadStates();
+
+    int mTcpFd{-1};
+    int mUdpFd{-1};
+
+    std::uint8_t mControl[kWelcomeSize];
+    int mControlSize{0};
+
+    bool mPlaying{false};
+    Side mSide{left};
+    std::int32_t mClient{0};
+    std::int32_t mToken{0};
+    int mTickRate{kBaseTickRate};
+
+    // Received states by tick, as baselines for the ones that follow
+    SimState mStates[kStateHistory]{};
+    int mStateTicks[kStateHistory]; // -1 for an empty slot
+    int mNewest{-1};
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_MATCH_CLIENT */
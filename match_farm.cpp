@@ -0,0 +1,210 @@
+#include "match_farm.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <optional>
+#include <thread>
+
+/* SdlPong::MatchResult SdlPong::PlayMatch {{{ */
+SdlPong::MatchResult SdlPong::PlayMatch(const FarmConfig &config,
+                                        PaddlePolicy &leftPolicy,
+                                        PaddlePolicy &rightPolicy,
+                                        TrajectoryWriter *dataset,
+                                        int episode) {
+    SdlPong::Simulation sim{config.tickRate};
+    sim.startGame(false);
+
+    std::optional<SdlPong::TrajectoryRecorder> recorder;
+    if (dataset != nullptr)
+        recorder.emplace(*dataset, episode, sim);
+
+    int ticks{0};
+    while (sim.getScore(SdlPong::left) < config.pointsToWin &&
+           sim.getScore(SdlPong::right) < config.pointsToWin &&
+           ticks < config.maxTicks) {
+        SdlPong::Inputs inputs{
+            .left = leftPolicy.act(sim, SdlPong::left),
+            .right = rightPolicy.act(sim, SdlPong::right)};
+        sim.step(inputs);
+        if (recorder)
+            recorder->step(sim, inputs);
+        ++ticks;
+    }
+
+    return {.leftScore = sim.getScore(SdlPong::left),
+            .rightScore = sim.getScore(SdlPong::right),
+            .ticks = ticks};
+} /* }}} */
+
+double SdlPong::PolicyStats::winRate() const {
+    int played{wins + losses + draws};
+    return played == 0 ? 0.0 : static_cast<double>(wins) / played;
+}
+
+SdlPong::MatchFarm::MatchFarm(FarmConfig config) : mConfig{config} {
+    assert(mConfig.pointsToWin > 0 && "Matches must be winnable");
+    assert(mConfig.matchesPerPairing >= 0 && "Negative number of matches");
+}
+
+int SdlPong::MatchFarm::addPolicy(std::string name, PolicyFactory factory) {
+    mNames.push_back(std::move(name));
+    mFactories.push_back(std::move(factory));
+    return static_cast<int>(mNames.size() - 1);
+}
+
+void SdlPong::MatchFarm::setDataset(TrajectoryWriter *dataset) {
+    mDataset = dataset;
+}
+
+/* void SdlPong::MatchFarm::run() {{{ */
+void SdlPong::MatchFarm::run() {
+    const int numPolicies{static_cast<int>(mNames.size())};
+
+    // Every ordered pair, so each policy plays both sides
+    mPairings.clear();
+    for (int l{0}; l < numPolicies; ++l) {
+        for (int r{0}; r < numPolicies; ++r) {
+            if (l == r)
+                continue;
+            PairingStats pairing{.leftPolicy = l, .rightPolicy = r};
+            pairing.marginHistogram.assign(2 * mConfig.pointsToWin + 1, 0);
+            mPairings.push_back(std::move(pairing));
+        }
+    }
+
+    const int numPairings{static_cast<int>(mPairings.size())};
+    mResults.assign(numPairings * mConfig.matchesPerPairing, {});
+
+    mNumThreads = mConfig.numThreads > 0
+                      ? mConfig.numThreads
+                      : static_cast<int>(std::thread::hardware_concurrency());
+    mNumThreads = std::max(mNumThreads, 1);
+
+    // Deal the matches out round-robin; workers that run dry steal the rest
+    std::vector<WorkStealingQueue<Task>> queues(mNumThreads);
+    int next{0};
+    for (int p{0}; p < numPairings; ++p) {
+        for (int m{0}; m < mConfig.matchesPerPairing; ++m)
+            queues[next++ % mNumThreads].push({.pairing = p, .match = m});
+    }
+
+    std::vector<std::thread> threads;
+    for (int t{1}; t < mNumThreads; ++t)
+        threads.emplace_back([this, t, &queues] { worker(t, queues); });
+    worker(0, queues);
+    for (std::thread &thread : threads)
+        thread.join();
+
+    // Aggregate
+    mPolicyStats.assign(numPolicies, {});
+    for (int p{0}; p < numPairings; ++p) {
+        PairingStats &pairing{mPairings[p]};
+        PolicyStats &left{mPolicyStats[pairing.leftPolicy]};
+        PolicyStats &right{mPolicyStats[pairing.rightPolicy]};
+
+        for (int m{0}; m < mConfig.matchesPerPairing; ++m) {
+            const MatchResult &result{
+                mResults[p * mConfig.matchesPerPairing + m]};
+
+            if (result.leftScore > result.rightScore) {
+                ++pairing.leftWins;
+                ++left.wins;
+                ++right.losses;
+            } else if (result.rightScore > result.leftScore) {
+                ++pairing.rightWins;
+                ++right.wins;
+                ++left.losses;
+            } else {
+                ++pairing.draws;
+                ++left.draws;
+                ++right.draws;
+            }
+
+            pairing.leftPoints += result.leftScore;
+            pairing.rightPoints += result.rightScore;
+            pairing.ticks += result.ticks;
+            left.pointsFor += result.leftScore;
+            left.pointsAgainst += result.rightScore;
+            right.pointsFor += result.rightScore;
+            right.pointsAgainst += result.leftScore;
+
+            int margin{std::clamp(result.leftScore - result.rightScore,
+                                  -mConfig.pointsToWin, mConfig.pointsToWin)};
+            ++pairing.marginHistogram[margin + mConfig.pointsToWin];
+        }
+    }
+} /* }}} */
+
+/* void SdlPong::MatchFarm::worker {{{
+ * Drain the own queue first, then steal from the others. No task creates
+ * new tasks, so once every queue is empty the worker is done.
+ * */
+void SdlPong::MatchFarm::worker(int self,
+                                std::vector<WorkStealingQueue<Task>> &queues) {
+    const int numQueues{static_cast<int>(queues.size())};
+    while (true) {
+        std::optional<Task> task{queues[self].pop()};
+        for (int i{1}; !task && i < numQueues; ++i)
+            task = queues[(self + i) % numQueues].steal();
+        if (!task)
+            return;
+        playTask(*task);
+    }
+} /* }}} */
+
+void SdlPong::MatchFarm::playTask(const Task &task) {
+    const PairingStats &pairing{mPairings[task.pairing]};
+    const int index{task.pairing * mConfig.matchesPerPairing + task.match};
+
+    // Distinct, reproducible seeds for each side of each match
+    std::uint32_t seed{mConfig.seed + 2 * static_cast<std::uint32_t>(index)};
+    std::unique_ptr<PaddlePolicy> leftPolicy{
+        mFactories[pairing.leftPolicy](seed)};
+    std::unique_ptr<PaddlePolicy> rightPolicy{
+        mFactories[pairing.rightPolicy](seed + 1)};
+
+    mResults[index] =
+        PlayMatch(mConfig, *leftPolicy, *rightPolicy, mDataset, index);
+}
+
+const std::vector<SdlPong::PairingStats> &
+SdlPong::MatchFarm::getPairings() const {
+    return mPairings;
+}
+
+const std::vector<SdlPong::PolicyStats> &
+SdlPong::MatchFarm::getPolicyStats() const {
+    return mPolicyStats;
+}
+
+const std::string &SdlPong::MatchFarm::getPolicyName(int policy) const {
+    return mNames[policy];
+}
+
+/* void SdlPong::MatchFarm::report(std::ostream &out) const {{{ */
+void SdlPong::MatchFarm::report(std::ostream &out) const {
+    out << "Played " << mResults.size() << " matches on " << mNumThreads
+        << " threads\n\n";
+
+    out << "Policy               win%    W    L    D  points for/against\n";
+    for (std::size_t i{0}; i < mPolicyStats.size(); ++i) {
+        const PolicyStats &stats{mPolicyStats[i]};
+        char line[128];
+        std::snprintf(line, sizeof(line),
+                      "%-18.18s %6.1f %4d %4d %4d  %lld/%lld\n",
+                      mNames[i].c_str(), 100.0 * stats.winRate(), stats.wins,
+                      stats.losses, stats.draws, stats.pointsFor,
+                      stats.pointsAgainst);
+        out << line;
+    }
+
+    out << "\nMargin histograms (left - right, from -" << mConfig.pointsToWin
+        << " to " << mConfig.pointsToWin << ")\n";
+    for (const PairingStats &pairing : mPairings) {
+        out << mNames[pairing.leftPolicy] << " vs "
+            << mNames[pairing.rightPolicy] << ":";
+        for (int count : pairing.marginHistogram)
+            out << ' ' << count;
+        out << '\n';
+    }
+} /* }}} */
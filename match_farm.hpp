@@ -0,0 +1,117 @@
+#ifndef _JC_MATCH_FARM
+#define _JC_MATCH_FARM
+
+#include "paddle_policy.hpp"
+#include "pong_sim.hpp"
+#include "trajectory.hpp"
+#include "work_queue.hpp"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Round-robin tournaments between paddle policies, played headless on every
+// core with a work-stealing scheduler.
+
+namespace SdlPong {
+
+struct FarmConfig {
+    int tickRate{kBaseTickRate};
+
+    int pointsToWin{11};
+    // A match that reaches this many ticks ends in a draw
+    int maxTicks{kBaseTickRate * 60 * 10};
+
+    // Matches played for every ordered (left, right) pair of policies
+    int matchesPerPairing{100};
+    // 0 uses every hardware thread
+    int numThreads{0};
+    std::uint32_t seed{0};
+};
+
+struct MatchResult {
+    int leftScore;
+    int rightScore;
+    int ticks;
+};
+
+// Play one match to completion, recording it into dataset as episode
+// unless dataset is null
+MatchResult PlayMatch(const FarmConfig &config, PaddlePolicy &leftPolicy,
+                      PaddlePolicy &rightPolicy,
+                      TrajectoryWriter *dataset = nullptr, int episode = 0);
+
+struct PairingStats {
+    int leftPolicy{0};
+    int rightPolicy{0};
+
+    int leftWins{0};
+    int rightWins{0};
+    int draws{0};
+    long long leftPoints{0};
+    long long rightPoints{0};
+    long long ticks{0};
+
+    // Count of matches by final margin, leftScore - rightScore, stored at
+    // index margin + pointsToWin
+    std::vector<int> marginHistogram{};
+};
+
+struct PolicyStats {
+    int wins{0};
+    int losses{0};
+    int draws{0};
+    long long pointsFor{0};
+    long long pointsAgainst{0};
+
+    double winRate() const;
+};
+
+class MatchFarm {
+
+  public:
+    explicit MatchFarm(FarmConfig config);
+
+    // Returns the index used in the stats
+    int addPolicy(std::string name, PolicyFactory factory);
+
+    // Record every match of the next run() into dataset, each as the
+    // episode of its index in the results. Null stops recording.
+    void setDataset(TrajectoryWriter *dataset);
+
+    // Play the whole round robin, blocking until every match is done
+    void run();
+
+    const std::vector<PairingStats> &getPairings() const;
+    const std::vector<PolicyStats> &getPolicyStats() const;
+    const std::string &getPolicyName(int policy) const;
+
+    // Human readable summary of the last run
+    void report(std::ostream &out) const;
+
+  private:
+    struct Task {
+        int pairing;
+        int match;
+    };
+
+    void worker(int self, std::vector<WorkStealingQueue<Task>> &queues);
+    void playTask(const Task &task);
+
+    FarmConfig mConfig;
+
+    std::vector<std::string> mNames;
+    std::vector<PolicyFactory> mFactories;
+
+    std::vector<PairingStats> mPairings;
+    std::vector<PolicyStats> mPolicyStats;
+
+    // Filled by workers, one slot per task, so no locking is needed
+    std::vector<MatchResult> mResults;
+    int mNumThreads{0};
+    TrajectoryWriter *mDataset{nullptr};
+};
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_MATCH_FARM */
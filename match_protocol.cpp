@@ -0,0 +1,121 @@
+#include "match_protocol.hpp"
+#include <cstring>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable_v<SdlPong::SimState> &&
+                  sizeof(SdlPong::SimState) ==
+                      SdlPong::kNumStateFields * sizeof(std::int32_t),
+              "SimState must be plain int32 fields");
+
+namespace {
+
+void ToFields(const SdlPong::SimState &state, std::uint32_t *fields) {
+    std::memcpy(fields, &state, sizeof(state));
+}
+
+void FromFields(const std::uint32_t *fields, SdlPong::SimState &state) {
+    std::memcpy(&state, fields, sizeof(state));
+}
+
+std::uint8_t *PutVarint(std::uint8_t *out, std::uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<std::uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<std::uint8_t>(value);
+    return out;
+}
+
+// False if the varint runs past end or is longer than 32 bits
+bool GetVarint(const std::uint8_t *&in, const std::uint8_t *end,
+               std::uint32_t &value) {
+    value = 0;
+    for (int shift{0}; shift < 35; shift += 7) {
+        if (in == end)
+            return false;
+        std::uint8_t byte{*in++};
+        value |= std::uint32_t{byte & 0x7Fu} << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Small differences of either sign become small unsigned numbers
+std::uint32_t ZigZag(std::uint32_t diff) {
+    return (diff << 1) ^ (0u - (diff >> 31));
+}
+
+std::uint32_t UnZigZag(std::uint32_t value) {
+    return (value >> 1) ^ (0u - (value & 1));
+}
+
+} // namespace
+
+void SdlPong::PutInt(std::uint8_t *out, std::int32_t value) {
+    std::uint32_t v{static_cast<std::uint32_t>(value)};
+    for (int i{0}; i < 4; ++i)
+        out[i] = static_cast<std::uint8_t>(v >> (8 * i));
+}
+
+std::int32_t SdlPong::GetInt(const std::uint8_t *in) {
+    std::uint32_t v{0};
+    for (int i{0}; i < 4; ++i)
+        v |= std::uint32_t{in[i]} << (8 * i);
+    return static_cast<std::int32_t>(v);
+}
+
+/* int SdlPong::EncodeDelta {{{ */
+int SdlPong::EncodeDelta(const SimState &base, const SimState &state,
+                         std::uint8_t *out) {
+    std::uint32_t before[kNumStateFields];
+    std::uint32_t after[kNumStateFields];
+    ToFields(base, before);
+    ToFields(state, after);
+
+    int changed{0};
+    for (int f{0}; f < kNumStateFields; ++f)
+        changed += before[f] != after[f];
+
+    // Differences wrap around in unsigned arithmetic, so every pair of
+    // values round-trips
+    std::uint8_t *pos{PutVarint(out, static_cast<std::uint32_t>(changed))};
+    int previous{-1};
+    for (int f{0}; f < kNumStateFields; ++f) {
+        if (before[f] == after[f])
+            continue;
+        pos = PutVarint(pos, static_cast<std::uint32_t>(f - previous));
+        pos = PutVarint(pos, ZigZag(after[f] - before[f]));
+        previous = f;
+    }
+    return static_cast<int>(pos - out);
+} /* }}} */
+
+/* bool SdlPong::DecodeDelta {{{ */
+bool SdlPong::DecodeDelta(const SimState &base, const std::uint8_t *in,
+                          int size, SimState &state) {
+    const std::uint8_t *end{in + size};
+    std::uint32_t fields[kNumStateFields];
+    ToFields(base, fields);
+
+    std::uint32_t changed;
+    if (!GetVarint(in, end, changed) || changed > kNumStateFields)
+        return false;
+
+    int field{-1};
+    for (std::uint32_t n{0}; n < changed; ++n) {
+        std::uint32_t step, diff;
+        if (!GetVarint(in, end, step) || !GetVarint(in, end, diff) ||
+            step == 0 || step > static_cast<std::uint32_t>(kNumStateFields))
+            return false;
+        field += static_cast<int>(step);
+        if (field >= kNumStateFields)
+            return false;
+        fields[field] += UnZigZag(diff);
+    }
+    if (in != end)
+        return false;
+
+    FromFields(fields, state);
+    return true;
+} /* }}} */
@@ -0,0 +1,71 @@
+#ifndef _JC_MATCH_PROTOCOL
+#define _JC_MATCH_PROTOCOL
+
+#include "pong_sim.hpp"
+#include <cstdint>
+
+// Messages between pong_server and the games connected to it. Joining goes
+// over TCP, whose connection also tells the server when a player leaves.
+// Inputs and states go over UDP every tick and are never resent; each state
+// is sent as the difference from one the client has confirmed, so losing a
+// packet only costs the next one a few bytes more. Integers are little
+// endian.
+
+namespace SdlPong {
+
+enum MessageType : std::uint8_t {
+    joinMessage = 1,
+    welcomeMessage,
+    inputMessage,
+    stateMessage,
+};
+
+// Who plays the other bar
+enum Opponent : std::uint8_t { humanOpponent, serverOpponent };
+
+// TCP, client to server, once after connecting:
+//   uint8 joinMessage, uint8 Opponent
+constexpr int kJoinSize{2};
+
+// TCP, server to client, when the match starts:
+//   uint8 welcomeMessage, uint8 Side, int32 client, int32 token,
+//   int32 server tick rate
+constexpr int kWelcomeSize{14};
+
+// UDP, client to server, every tick:
+//   uint8 inputMessage, int32 client, int32 token, uint8 BarDirection,
+//   int32 newest state tick received or -1
+constexpr int kInputSize{14};
+
+// UDP, server to client, every tick:
+//   uint8 stateMessage, int32 tick, int32 tick of the baseline or -1 for
+//   none, then the state as written by EncodeDelta
+constexpr int kStateHeaderSize{9};
+
+// States each side keeps for use as baselines. A confirmation older than
+// this makes the server send a whole state again.
+constexpr int kStateHistory{32};
+
+// Fields of a SimState, all int32
+constexpr int kNumStateFields{sizeof(SimState) / sizeof(std::int32_t)};
+
+// Longest output of EncodeDelta: a count, then an index step and a value
+// for every field
+constexpr int kMaxDeltaSize{2 + kNumStateFields * 6};
+
+void PutInt(std::uint8_t *out, std::int32_t value);
+std::int32_t GetInt(const std::uint8_t *in);
+
+// Write the fields of state that differ from base, as the step from the
+// previous changed field and the zigzag difference, both as varints.
+// Returns the bytes written, at most kMaxDeltaSize.
+int EncodeDelta(const SimState &base, const SimState &state,
+                std::uint8_t *out);
+// Apply size bytes of EncodeDelta output to base. Returns false if they
+// are malformed.
+bool DecodeDelta(const SimState &base, const std::uint8_t *in, int size,
+                 SimState &state);
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_MATCH_PROTOCOL */
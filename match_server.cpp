@@ -0,0 +1,491 @@
+#include "match_server.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// epoll keys; clients use their id plus kFirstClientKey
+constexpr std::uint64_t kListenKey{0};
+constexpr std::uint64_t kUdpKey{1};
+constexpr std::uint64_t kFirstClientKey{2};
+
+// Room for a burst of states from every shard
+constexpr int kSocketBufferBytes{4 << 20};
+
+} // namespace
+
+/* SdlPong::MatchServer::MatchServer(ServerConfig config) {{{ */
+SdlPong::MatchServer::MatchServer(ServerConfig config)
+    : mConfig{config}, mTokens{std::random_device{}()} {
+    assert(mConfig.tickRate > 0 && "Tick rate must be positive");
+    assert(mConfig.pointsToWin > 0 && "Matches must be winnable");
+
+    int workers{mConfig.numWorkers};
+    if (workers <= 0)
+        workers = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    workers = std::max(workers, 1);
+    for (int w{0}; w < workers; ++w)
+        mShards.push_back(std::make_unique<Shard>());
+    mPending.resize(workers);
+} /* }}} */
+
+/* SdlPong::MatchServer::~MatchServer() {{{ */
+SdlPong::MatchServer::~MatchServer() {
+    stop();
+    for (auto &shard : mShards) {
+        if (shard->thread.joinable())
+            shard->thread.join();
+    }
+    for (const Client &client : mClients) {
+        if (client.fd >= 0)
+            close(client.fd);
+    }
+    for (int fd : {mEpollFd, mListenFd, mUdpFd}) {
+        if (fd >= 0)
+            close(fd);
+    }
+} /* }}} */
+
+/* bool SdlPong::MatchServer::open() {{{ */
+bool SdlPong::MatchServer::open() {
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(static_cast<std::uint16_t>(mConfig.port));
+    const auto *address{reinterpret_cast<const sockaddr *>(&local)};
+
+    mListenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    mUdpFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    mEpollFd = epoll_create1(0);
+    if (mListenFd < 0 || mUdpFd < 0 || mEpollFd < 0)
+        return false;
+
+    int reuse{1};
+    setsockopt(mListenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    // Best effort; the kernel may cap the sizes
+    setsockopt(mUdpFd, SOL_SOCKET, SO_SNDBUF, &kSocketBufferBytes,
+               sizeof(kSocketBufferBytes));
+    setsockopt(mUdpFd, SOL_SOCKET, SO_RCVBUF, &kSocketBufferBytes,
+               sizeof(kSocketBufferBytes));
+
+    if (bind(mListenFd, address, sizeof(local)) != 0 ||
+        listen(mListenFd, SOMAXCONN) != 0 ||
+        bind(mUdpFd, address, sizeof(local)) != 0)
+        return false;
+
+    epoll_event tcpEvent{.events = EPOLLIN, .data = {.u64 = kListenKey}};
+    epoll_event udpEvent{.events = EPOLLIN, .data = {.u64 = kUdpKey}};
+    return epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mListenFd, &tcpEvent) == 0 &&
+           epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mUdpFd, &udpEvent) == 0;
+} /* }}} */
+
+/* void SdlPong::MatchServer::run() {{{ */
+void SdlPong::MatchServer::run() {
+    assert(mEpollFd >= 0 && "run() before a successful open()");
+
+    for (int s{0}; s < static_cast<int>(mShards.size()); ++s)
+        mShards[s]->thread = std::thread{[this, s] { Worker(s); }};
+
+    epoll_event events[kMaxEvents];
+    while (!mStopping.load(std::memory_order_relaxed)) {
+        int n{epoll_wait(mEpollFd, events, kMaxEvents, kPollTimeoutMs)};
+        if (n < 0 && errno != EINTR)
+            break;
+
+        for (int i{0}; i < n; ++i) {
+            const std::uint64_t key{events[i].data.u64};
+            if (key == kListenKey)
+                Accept();
+            else if (key == kUdpKey)
+                ReadUdp();
+            else {
+                // Skip clients dropped earlier in this batch
+                const int id{static_cast<int>(key - kFirstClientKey)};
+                if (mClients[id].fd >= 0)
+                    ReadTcp(id);
+            }
+        }
+        FlushPosts();
+    }
+
+    stop();
+    for (auto &shard : mShards)
+        shard->thread.join();
+} /* }}} */
+
+void SdlPong::MatchServer::stop() {
+    mStopping.store(true, std::memory_order_relaxed);
+}
+
+int SdlPong::MatchServer::getNumWorkers() const {
+    return static_cast<int>(mShards.size());
+}
+
+int SdlPong::MatchServer::getNumClients() const { return mNumClients; }
+
+int SdlPong::MatchServer::getNumMatches() const {
+    int matches{0};
+    for (const auto &shard : mShards)
+        matches += shard->numMatches.load(std::memory_order_relaxed);
+    return matches;
+}
+
+long long SdlPong::MatchServer::getLateTicks() const {
+    long long late{0};
+    for (const auto &shard : mShards)
+        late += shard->lateTicks.load(std::memory_order_relaxed);
+    return late;
+}
+
+/* void SdlPong::MatchServer::Accept() {{{ */
+void SdlPong::MatchServer::Accept() {
+    int fd;
+    while ((fd = accept4(mListenFd, nullptr, nullptr, SOCK_NONBLOCK)) >= 0) {
+        int noDelay{1};
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        int id;
+        if (mFreeClients.empty()) {
+            id = static_cast<int>(mClients.size());
+            mClients.emplace_back();
+        } else {
+            id = mFreeClients.back();
+            mFreeClients.pop_back();
+        }
+        mClients[id] = {.fd = fd,
+                        .token = static_cast<std::int32_t>(mTokens())};
+
+        epoll_event event{.events = EPOLLIN,
+                          .data = {.u64 = kFirstClientKey + id}};
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            mClients[id].fd = -1;
+            mFreeClients.push_back(id);
+            continue;
+        }
+        ++mNumClients;
+    }
+} /* }}} */
+
+/* void SdlPong::MatchServer::ReadTcp(int id) {{{
+ * The join request is all a client sends over TCP; after it the connection
+ * only has to close for the server to know the player left.
+ * */
+void SdlPong::MatchServer::ReadTcp(int id) {
+    while (true) {
+        std::uint8_t buffer[64];
+        ssize_t n{recv(mClients[id].fd, buffer, sizeof(buffer), 0)};
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (n <= 0) {
+            Drop(id);
+            return;
+        }
+
+        Client &client{mClients[id]};
+        if (client.joinSize == kJoinSize)
+            continue;
+        int take{std::min(static_cast<int>(n), kJoinSize - client.joinSize)};
+        std::memcpy(client.join + client.joinSize, buffer, take);
+        client.joinSize += take;
+        if (client.joinSize < kJoinSize)
+            continue;
+
+        if (client.join[0] != joinMessage || client.join[1] > serverOpponent) {
+            Drop(id);
+            return;
+        }
+        if (client.join[1] == serverOpponent) {
+            // Like the one-player game, the AI plays the left bar
+            StartMatch(-1, id);
+        } else if (mWaiting >= 0) {
+            StartMatch(mWaiting, id);
+            mWaiting = -1;
+        } else {
+            mWaiting = id;
+        }
+    }
+} /* }}} */
+
+/* void SdlPong::MatchServer::ReadUdp() {{{ */
+void SdlPong::MatchServer::ReadUdp() {
+    std::uint8_t packets[kBatch][kInputSize + 1];
+    sockaddr_in from[kBatch];
+    iovec iovs[kBatch];
+    mmsghdr messages[kBatch];
+
+    while (true) {
+        for (int i{0}; i < kBatch; ++i) {
+            // One spare byte, so longer datagrams show up as too long
+            iovs[i] = {.iov_base = packets[i], .iov_len = sizeof(packets[i])};
+            messages[i] = {};
+            messages[i].msg_hdr.msg_name = &from[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(from[i]);
+            messages[i].msg_hdr.msg_iov = &iovs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        int n{recvmmsg(mUdpFd, messages, kBatch, MSG_DONTWAIT, nullptr)};
+        if (n <= 0)
+            return;
+
+        for (int i{0}; i < n; ++i) {
+            const std::uint8_t *packet{packets[i]};
+            if (messages[i].msg_len != kInputSize ||
+                packet[0] != inputMessage || packet[9] > none)
+                continue;
+            const int id{GetInt(packet + 1)};
+            if (id < 0 || id >= static_cast<int>(mClients.size()))
+                continue;
+            const Client &client{mClients[id]};
+            if (client.fd < 0 || client.match < 0 ||
+                client.token != GetInt(packet + 5))
+                continue;
+
+            Post(client.match,
+                 {.kind = inputEvent,
+                  .match = client.match,
+                  .side = client.side,
+                  .input = static_cast<BarDirection>(packet[9]),
+                  .ack = GetInt(packet + 10),
+                  .from = from[i]});
+        }
+        if (n < kBatch)
+            return;
+    }
+} /* }}} */
+
+/* void SdlPong::MatchServer::Drop(int id) {{{ */
+void SdlPong::MatchServer::Drop(int id) {
+    Client &client{mClients[id]};
+    if (mWaiting == id)
+        mWaiting = -1;
+    if (client.match >= 0)
+        Post(client.match, {.kind = leaveEvent,
+                            .match = client.match,
+                            .side = client.side});
+
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+    close(client.fd);
+    client = {};
+    mFreeClients.push_back(id);
+    --mNumClients;
+} /* }}} */
+
+/* void SdlPong::MatchServer::StartMatch {{{ */
+void SdlPong::MatchServer::StartMatch(int leftClient, int rightClient) {
+    const int match{mNextMatch++};
+    const int clients[2]{leftClient, rightClient};
+
+    for (int side : {left, right}) {
+        if (clients[side] < 0)
+            continue;
+        Client &client{mClients[clients[side]]};
+        client.match = match;
+        client.side = static_cast<Side>(side);
+
+        std::uint8_t welcome[kWelcomeSize];
+        welcome[0] = welcomeMessage;
+        welcome[1] = static_cast<std::uint8_t>(side);
+        PutInt(welcome + 2, clients[side]);
+        PutInt(welcome + 6, client.token);
+        PutInt(welcome + 10, mConfig.tickRate);
+        // A fresh connection always has room for a few bytes
+        send(client.fd, welcome, sizeof(welcome), MSG_NOSIGNAL);
+    }
+
+    Post(match, {.kind = startEvent,
+                 .match = match,
+                 .clients = {leftClient, rightClient}});
+} /* }}} */
+
+void SdlPong::MatchServer::Post(int match, const Event &event) {
+    mPending[match % mShards.size()].push_back(event);
+}
+
+/* void SdlPong::MatchServer::FlushPosts() {{{ */
+void SdlPong::MatchServer::FlushPosts() {
+    for (std::size_t s{0}; s < mShards.size(); ++s) {
+        if (mPending[s].empty())
+            continue;
+        Shard &shard{*mShards[s]};
+        {
+            std::lock_guard<std::mutex> lock{shard.mutex};
+            shard.inbox.insert(shard.inbox.end(), mPending[s].begin(),
+                               mPending[s].end());
+        }
+        mPending[s].clear();
+    }
+} /* }}} */
+
+/* void SdlPong::MatchServer::Worker(int s) {{{ */
+void SdlPong::MatchServer::Worker(int s) {
+    using Clock = std::chrono::steady_clock;
+    Shard &shard{*mShards[s]};
+    const auto tickLength{std::chrono::nanoseconds{1000000000} /
+                          mConfig.tickRate};
+
+    Clock::time_point next{Clock::now()};
+    while (!mStopping.load(std::memory_order_relaxed)) {
+        next += tickLength;
+        const Clock::time_point now{Clock::now()};
+        if (now < next) {
+            std::this_thread::sleep_until(next);
+        } else {
+            shard.lateTicks.fetch_add(1, std::memory_order_relaxed);
+            // Too far behind to catch up; drop the missed ticks
+            if (now - next > kMaxLagTicks * tickLength)
+                next = now;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{shard.mutex};
+            std::swap(shard.events, shard.inbox);
+        }
+        for (const Event &event : shard.events)
+            Apply(shard, event);
+        shard.events.clear();
+
+        for (auto it{shard.matches.begin()}; it != shard.matches.end();) {
+            Match &match{it->second};
+            if (match.seats[left].client < 0 &&
+                match.seats[right].client < 0) {
+                it = shard.matches.erase(it);
+                continue;
+            }
+            Tick(match);
+            Broadcast(shard, match);
+            ++it;
+        }
+        Send(shard);
+
+        shard.numMatches.store(static_cast<int>(shard.matches.size()),
+                               std::memory_order_relaxed);
+    }
+} /* }}} */
+
+/* void SdlPong::MatchServer::Apply {{{ */
+void SdlPong::MatchServer::Apply(Shard &shard, const Event &event) {
+    if (event.kind == startEvent) {
+        Match &match{
+            shard.matches.try_emplace(event.match, mConfig.tickRate)
+                .first->second};
+        for (int side : {left, right})
+            match.seats[side].client = event.clients[side];
+        if (event.clients[left] < 0 || event.clients[right] < 0)
+            match.ai = std::make_unique<InterceptPolicy>(
+                normalAI, static_cast<std::uint32_t>(event.match));
+        match.sim.startGame(false);
+        match.history[0] = match.sim.saveState();
+        return;
+    }
+
+    auto found{shard.matches.find(event.match)};
+    if (found == shard.matches.end())
+        return;
+    Match &match{found->second};
+    Seat &seat{match.seats[event.side]};
+    if (seat.client < 0)
+        return;
+
+    if (event.kind == leaveEvent) {
+        // The match is forfeited and only kept for the other player
+        seat = {};
+        match.over = true;
+        return;
+    }
+
+    seat.input = event.input;
+    if (event.ack > seat.ack && event.ack <= match.tick)
+        seat.ack = event.ack;
+    // Follows the player if their address changes
+    seat.address = event.from;
+    seat.hasAddress = true;
+} /* }}} */
+
+/* void SdlPong::MatchServer::Tick(Match &match) {{{ */
+void SdlPong::MatchServer::Tick(Match &match) {
+    if (match.over)
+        return;
+
+    BarDirection inputs[2];
+    for (int side : {left, right}) {
+        const Seat &seat{match.seats[side]};
+        inputs[side] = seat.client >= 0
+                           ? seat.input
+                           : match.ai->act(match.sim, static_cast<Side>(side));
+    }
+    match.sim.step({.left = inputs[left], .right = inputs[right]});
+
+    ++match.tick;
+    match.history[match.tick % kStateHistory] = match.sim.saveState();
+    if (match.sim.getScore(left) >= mConfig.pointsToWin ||
+        match.sim.getScore(right) >= mConfig.pointsToWin)
+        match.over = true;
+} /* }}} */
+
+/* void SdlPong::MatchServer::Broadcast(Shard &shard, Match &match) {{{
+ * Queue the newest state for each player as a delta from the newest one
+ * they confirmed, or whole if that has left the history.
+ * */
+void SdlPong::MatchServer::Broadcast(Shard &shard, Match &match) {
+    const SimState &state{match.history[match.tick % kStateHistory]};
+    for (const Seat &seat : match.seats) {
+        // A finished match is only sent until the player has it
+        if (seat.client < 0 || !seat.hasAddress || seat.ack == match.tick)
+            continue;
+
+        const bool known{seat.ack >= 0 &&
+                         match.tick - seat.ack < kStateHistory};
+        const SimState base{known ? match.history[seat.ack % kStateHistory]
+                                  : SimState{}};
+
+        const std::size_t offset{shard.packets.size()};
+        shard.packets.resize(offset + kMaxStatePacket);
+        std::uint8_t *packet{shard.packets.data() + offset};
+        packet[0] = stateMessage;
+        PutInt(packet + 1, match.tick);
+        PutInt(packet + 5, known ? seat.ack : -1);
+        const int size{kStateHeaderSize +
+                       EncodeDelta(base, state, packet + kStateHeaderSize)};
+
+        shard.sizes.push_back(size);
+        shard.addresses.push_back(seat.address);
+    }
+} /* }}} */
+
+/* void SdlPong::MatchServer::Send(Shard &shard) {{{ */
+void SdlPong::MatchServer::Send(Shard &shard) {
+    const int count{static_cast<int>(shard.sizes.size())};
+    iovec iovs[kBatch];
+    mmsghdr messages[kBatch];
+
+    for (int first{0}; first < count; first += kBatch) {
+        const int n{std::min(kBatch, count - first)};
+        for (int i{0}; i < n; ++i) {
+            const int p{first + i};
+            iovs[i] = {.iov_base = shard.packets.data() +
+                                   static_cast<std::size_t>(p) *
+                                       kMaxStatePacket,
+                       .iov_len = static_cast<std::size_t>(shard.sizes[p])};
+            messages[i] = {};
+            messages[i].msg_hdr.msg_name = &shard.addresses[p];
+            messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            messages[i].msg_hdr.msg_iov = &iovs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        // States that do not fit in the socket buffer are dropped like any
+        // other lost datagram; the next tick's delta covers them
+        sendmmsg(mUdpFd, messages, n, MSG_DONTWAIT);
+    }
+
+    shard.packets.clear();
+    shard.sizes.clear();
+    shard.addresses.clear();
+} /* }}} */
@@ -0,0 +1,172 @@
+#ifndef _JC_MATCH_SERVER
+#define _JC_MATCH_SERVER
+
+#include "match_protocol.hpp"
+#include "paddle_policy.hpp"
+#include "pong_sim.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Many matches in one headless process. A single network thread waits on
+// every socket with epoll, pairs up players and hands their inputs to the
+// shard that owns their match. Each shard is a worker thread that ticks
+// its matches at a fixed rate and sends every player a state delta.
+
+namespace SdlPong {
+
+struct ServerConfig {
+    // TCP and UDP port
+    int port{27970};
+    int tickRate{kBaseTickRate};
+    // 0 uses every hardware thread but the network one
+    int numWorkers{0};
+    // A match stops once a side reaches this many points
+    int pointsToWin{11};
+};
+
+/* class MatchServer {{{
+ * Joining, leaving and inputs reach a shard as events in its inbox, which
+ * the worker empties once per tick, so match state is only ever touched by
+ * the thread that owns it. Players are told apart by the id and token
+ * handed out in their welcome.
+ * */
+class MatchServer {
+  public:
+    explicit MatchServer(ServerConfig config);
+    ~MatchServer();
+
+    MatchServer(const MatchServer &) = delete;
+    MatchServer &operator=(const MatchServer &) = delete;
+
+    // Listen for TCP and UDP on the configured port
+    bool open();
+    // Serve until stop() is called, then wait for the workers
+    void run();
+    // Safe to call from a signal handler or any thread
+    void stop();
+
+    int getNumWorkers() const;
+    int getNumClients() const;
+    // Matches being played, summed over the shards
+    int getNumMatches() const;
+    // Ticks a worker started late because the one before overran
+    long long getLateTicks() const;
+
+  private:
+    // How far behind a worker may fall before it skips ticks instead of
+    // running them back to back
+    static constexpr int kMaxLagTicks{5};
+    // Longest wait for network events, which bounds how long stop() takes
+    static constexpr int kPollTimeoutMs{100};
+    static constexpr int kMaxEvents{256};
+    // Datagrams per recvmmsg and sendmmsg call
+    static constexpr int kBatch{64};
+    static constexpr int kMaxStatePacket{kStateHeaderSize + kMaxDeltaSize};
+
+    enum EventKind { startEvent, inputEvent, leaveEvent };
+
+    struct Event {
+        EventKind kind;
+        int match;
+        Side side{left};
+        // startEvent: the players on each side, -1 for the server AI
+        int clients[2]{-1, -1};
+        // inputEvent
+        BarDirection input{none};
+        int ack{-1};
+        sockaddr_in from{};
+    };
+
+    struct Seat {
+        int client{-1}; // -1 once left, or for the server AI
+        BarDirection input{none};
+        int ack{-1}; // newest state the player confirmed
+        bool hasAddress{false};
+        sockaddr_in address{};
+    };
+
+    struct Match {
+        explicit Match(int tickRate) : sim{tickRate} {}
+
+        Simulation sim;
+        Seat seats[2];
+        // Plays every seat that never had a client
+        std::unique_ptr<PaddlePolicy> ai;
+        int tick{0};
+        bool over{false};
+        // State after tick t is at t % kStateHistory
+        SimState history[kStateHistory];
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::vector<Event> inbox; // guarded by mutex
+
+        // Owned by the worker
+        std::unordered_map<int, Match> matches;
+        std::vector<Event> events;
+        // States of one tick, kMaxStatePacket bytes apart, sent together
+        std::vector<std::uint8_t> packets;
+        std::vector<int> sizes;
+        std::vector<sockaddr_in> addresses;
+
+        std::atomic<int> numMatches{0};
+        std::atomic<long long> lateTicks{0};
+        std::thread thread;
+    };
+
+    struct Client {
+        int fd{-1}; // -1 for a free slot
+        std::int32_t token{0};
+        int match{-1}; // -1 until paired
+        Side side{left};
+        std::uint8_t join[kJoinSize]{};
+        int joinSize{0};
+    };
+
+    // Network thread
+    void Accept();
+    void ReadTcp(int client);
+    void ReadUdp();
+    void Drop(int client);
+    void StartMatch(int leftClient, int rightClient);
+    void Post(int match, const Event &event);
+    void FlushPosts();
+
+    // Workers
+    void Worker(int shard);
+    void Apply(Shard &shard, const Event &event);
+    void Tick(Match &match);
+    void Broadcast(Shard &shard, Match &match);
+    void Send(Shard &shard);
+
+    ServerConfig mConfig;
+    std::atomic<bool> mStopping{false};
+
+    int mEpollFd{-1};
+    int mListenFd{-1};
+    int mUdpFd{-1};
+
+    std::vector<Client> mClients; // indexed by client id
+    std::vector<int> mFreeClients;
+    std::atomic<int> mNumClients{0};
+    int mWaiting{-1}; // client waiting for a human opponent
+    int mNextMatch{0};
+    std::minstd_rand mTokens;
+
+    std::vector<std::unique_ptr<Shard>> mShards;
+    // Events gathered in one pass of the network loop, by shard, and
+    // posted together so each inbox is locked once
+    std::vector<std::vector<Event>> mPending;
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_MATCH_SERVER */
@@ -0,0 +1,376 @@
+#include "mlp.hpp"
+#include "mlp_kernel.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[8] = {'P', 'O', 'N', 'G', 'M', 'L', 'P', '1'};
+
+// Refuse weights files describing absurdly large layers
+constexpr int kMaxLayerSize{1 << 14};
+constexpr int kMaxLayers{64};
+
+// kMlpBlock lanes kept in plain arrays; the compiler is free to vectorize
+// the loops for the baseline instruction set
+struct ScalarOps {
+    struct F {
+        float v[SdlPong::kMlpBlock];
+    };
+    struct I {
+        std::int32_t v[SdlPong::kMlpBlock];
+    };
+
+    static F load(const float *p) {
+        F r;
+        std::memcpy(r.v, p, sizeof(r.v));
+        return r;
+    }
+    static void store(float *p, const F &a) {
+        std::memcpy(p, a.v, sizeof(a.v));
+    }
+    static F set1(float x) {
+        F r;
+        std::fill(r.v, r.v + SdlPong::kMlpBlock, x);
+        return r;
+    }
+    static F fmadd(const F &a, const F &b, const F &c) {
+        F r;
+        for (int j{0}; j < SdlPong::kMlpBlock; ++j)
+            r.v[j] = a.v[j] * b.v[j] + c.v[j];
+        return r;
+    }
+    static F mul(const F &a, const F &b) {
+        F r;
+        for (int j{0}; j < SdlPong::kMlpBlock; ++j)
+            r.v[j] = a.v[j] * b.v[j];
+        return r;
+    }
+    static F toFloat(const I &a) {
+        F r;
+        for (int j{0}; j < SdlPong::kMlpBlock; ++j)
+            r.v[j] = static_cast<float>(a.v[j]);
+        return r;
+    }
+    static I izero() { return {}; }
+    static I madd2(I acc, const std::int8_t *w, const std::int16_t *x) {
+        for (int j{0}; j < SdlPong::kMlpBlock; ++j)
+            acc.v[j] += w[2 * j] * x[0] + w[2 * j + 1] * x[1];
+        return acc;
+    }
+};
+
+int Padded(int n) {
+    return (n + SdlPong::kMlpBlock - 1) / SdlPong::kMlpBlock *
+           SdlPong::kMlpBlock;
+}
+
+// Pade approximant of tanh, within 1e-4 of it everywhere. Unlike
+// std::tanh it vectorizes.
+float FastTanh(float x) {
+    float x2{x * x};
+    float p{x * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2)))};
+    float q{135135.0f + x2 * (62370.0f + x2 * (3150.0f + x2 * 28.0f))};
+    return std::clamp(p / q, -1.0f, 1.0f);
+}
+
+/* void Activate {{{
+ * Apply the activation in place to whole rows. Padding columns are zero
+ * before and after.
+ * */
+void Activate(SdlPong::Activation activation, float *rows, int count) {
+    switch (activation) {
+    case SdlPong::linearActivation:
+        break;
+    case SdlPong::reluActivation:
+        for (int i{0}; i < count; ++i)
+            rows[i] = std::max(rows[i], 0.0f);
+        break;
+    case SdlPong::tanhActivation:
+        for (int i{0}; i < count; ++i)
+            rows[i] = FastTanh(rows[i]);
+        break;
+    }
+} /* }}} */
+
+/* void QuantizeRows {{{
+ * Symmetric int8 quantization of each row with its own scale, so that the
+ * largest magnitude in the row maps to 127
+ * */
+void QuantizeRows(const float *rows, int batch, int width,
+                  std::int16_t *out, float *scales) {
+    for (int i{0}; i < batch; ++i) {
+        const float *row{rows + i * width};
+
+        // Separate maxima per lane so the compiler can vectorize them;
+        // width is a multiple of kMlpBlock
+        float lanes[SdlPong::kMlpBlock]{};
+        for (int k{0}; k < width; k += SdlPong::kMlpBlock)
+            for (int j{0}; j < SdlPong::kMlpBlock; ++j)
+                lanes[j] = std::max(lanes[j], std::fabs(row[k + j]));
+        float maxAbs{*std::max_element(lanes, lanes + SdlPong::kMlpBlock)};
+
+        float scale{maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f};
+        float inv{1.0f / scale};
+        // Round half away from zero without a library call
+        for (int k{0}; k < width; ++k)
+            out[i * width + k] = static_cast<std::int16_t>(
+                row[k] * inv + (row[k] < 0.0f ? -0.5f : 0.5f));
+        scales[i] = scale;
+    }
+} /* }}} */
+
+bool WriteWords(std::FILE *file, const void *values, int count) {
+    const std::uint32_t *words{static_cast<const std::uint32_t *>(values)};
+    for (int i{0}; i < count; ++i) {
+        std::uint32_t v{words[i]};
+        unsigned char bytes[4]{static_cast<unsigned char>(v),
+                               static_cast<unsigned char>(v >> 8),
+                               static_cast<unsigned char>(v >> 16),
+                               static_cast<unsigned char>(v >> 24)};
+        if (std::fwrite(bytes, 1, 4, file) != 4)
+            return false;
+    }
+    return true;
+}
+
+bool ReadWords(std::FILE *file, void *values, int count) {
+    std::uint32_t *words{static_cast<std::uint32_t *>(values)};
+    for (int i{0}; i < count; ++i) {
+        unsigned char bytes[4];
+        if (std::fread(bytes, 1, 4, file) != 4)
+            return false;
+        words[i] = std::uint32_t{bytes[0]} | std::uint32_t{bytes[1]} << 8 |
+                   std::uint32_t{bytes[2]} << 16 |
+                   std::uint32_t{bytes[3]} << 24;
+    }
+    return true;
+}
+
+// Bytes from the current position to the end of file, -1 if unknown
+long RemainingBytes(std::FILE *file) {
+    const long position{std::ftell(file)};
+    if (position < 0 || std::fseek(file, 0, SEEK_END) != 0)
+        return -1;
+    const long end{std::ftell(file)};
+    if (std::fseek(file, position, SEEK_SET) != 0)
+        return -1;
+    return end - position;
+}
+
+} // namespace
+
+static_assert(sizeof(float) == sizeof(std::uint32_t),
+              "Weights files store IEEE single precision floats");
+
+void SdlPong::DenseFloatScalar(const MlpLayer &layer, const float *in,
+                               float *out, int begin, int end) {
+    SdlPong::DenseFloatLanes<ScalarOps>(layer, in, out, begin, end);
+}
+
+void SdlPong::DenseInt8Scalar(const MlpLayer &layer, const std::int16_t *in,
+                              const float *inScales, float *out, int begin,
+                              int end) {
+    SdlPong::DenseInt8Lanes<ScalarOps>(layer, in, inScales, out, begin, end);
+}
+
+/* SdlPong::Mlp::Mlp {{{ */
+SdlPong::Mlp::Mlp()
+    : mFloatKernel{SdlPong::DenseFloatScalar},
+      mInt8Kernel{SdlPong::DenseInt8Scalar}, mKernelName{"scalar"} {
+
+    // Pick the widest kernels this CPU runs
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+#ifdef PONG_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        mFloatKernel = SdlPong::DenseFloatAVX2;
+        mInt8Kernel = SdlPong::DenseInt8AVX2;
+        mKernelName = "avx2";
+    }
+#endif
+#endif
+}
+/* }}} */
+
+/* void SdlPong::Mlp::addLayer {{{ */
+void SdlPong::Mlp::addLayer(int inputs, int outputs, Activation activation,
+                            const float *weights, const float *bias) {
+    assert(inputs > 0 && outputs > 0 && "Empty layer");
+    assert((mLayers.empty() || mLayers.back().usedOutputs == inputs) &&
+           "Layer does not fit the previous one");
+
+    SdlPong::MlpLayer layer;
+    layer.inputs = Padded(inputs);
+    layer.outputs = Padded(outputs);
+    layer.usedInputs = inputs;
+    layer.usedOutputs = outputs;
+    layer.activation = activation;
+    layer.weights.assign(layer.outputs * layer.inputs, 0.0f);
+    layer.bias.assign(layer.outputs, 0.0f);
+    layer.qweights.assign(layer.outputs * layer.inputs, 0);
+    layer.qscales.assign(layer.outputs, 1.0f);
+
+    for (int j{0}; j < outputs; ++j) {
+        const float *row{weights + j * inputs};
+        int block{j / kMlpBlock * kMlpBlock};
+        int lane{j % kMlpBlock};
+
+        float maxAbs{0.0f};
+        for (int k{0}; k < inputs; ++k)
+            maxAbs = std::max(maxAbs, std::fabs(row[k]));
+        float scale{maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f};
+
+        for (int k{0}; k < inputs; ++k) {
+            layer.weights[block * layer.inputs + k * kMlpBlock + lane] =
+                row[k];
+            layer.qweights[block * layer.inputs + k / 2 * 2 * kMlpBlock +
+                           lane * 2 + k % 2] =
+                static_cast<std::int8_t>(std::lrint(row[k] / scale));
+        }
+        layer.bias[j] = bias[j];
+        layer.qscales[j] = scale;
+    }
+
+    mLayers.push_back(std::move(layer));
+} /* }}} */
+
+/* bool SdlPong::Mlp::load(const std::string &path) {{{ */
+bool SdlPong::Mlp::load(const std::string &path) {
+    std::FILE *file{std::fopen(path.c_str(), "rb")};
+    if (file == nullptr)
+        return false;
+
+    char magic[sizeof(kMagic)];
+    std::int32_t numLayers;
+    bool ok{std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+            std::memcmp(magic, kMagic, sizeof(kMagic)) == 0 &&
+            ReadWords(file, &numLayers, 1) && numLayers > 0 &&
+            numLayers <= kMaxLayers};
+
+    std::vector<SdlPong::MlpLayer> previous;
+    previous.swap(mLayers);
+
+    std::vector<float> weights;
+    std::vector<float> bias;
+    for (int i{0}; ok && i < numLayers; ++i) {
+        std::int32_t header[3];
+        ok = ReadWords(file, header, 3) && header[0] > 0 &&
+             header[0] <= kMaxLayerSize && header[1] > 0 &&
+             header[1] <= kMaxLayerSize && header[2] >= 0 &&
+             header[2] < kNumActivations &&
+             (mLayers.empty() || mLayers.back().usedOutputs == header[0]);
+        // Check the file holds the layer before allocating for it
+        ok = ok && RemainingBytes(file) >=
+                       (std::int64_t{header[0]} * header[1] + header[1]) * 4;
+        if (!ok)
+            break;
+
+        weights.resize(header[0] * header[1]);
+        bias.resize(header[1]);
+        ok = ReadWords(file, weights.data(), header[0] * header[1]) &&
+             ReadWords(file, bias.data(), header[1]);
+        if (ok)
+            addLayer(header[0], header[1],
+                     static_cast<SdlPong::Activation>(header[2]),
+                     weights.data(), bias.data());
+    }
+
+    std::fclose(file);
+    // Keep the old network when the file is bad
+    if (!ok)
+        mLayers.swap(previous);
+    return ok;
+} /* }}} */
+
+/* bool SdlPong::Mlp::save(const std::string &path) const {{{ */
+bool SdlPong::Mlp::save(const std::string &path) const {
+    std::FILE *file{std::fopen(path.c_str(), "wb")};
+    if (file == nullptr)
+        return false;
+
+    std::int32_t numLayers{getNumLayers()};
+    bool ok{std::fwrite(kMagic, 1, sizeof(kMagic), file) == sizeof(kMagic) &&
+            WriteWords(file, &numLayers, 1)};
+
+    std::vector<float> weights;
+    for (const SdlPong::MlpLayer &layer : mLayers) {
+        std::int32_t header[3]{layer.usedInputs, layer.usedOutputs,
+                               layer.activation};
+
+        // Back from the packed layout to [outputs][inputs]
+        weights.resize(layer.usedOutputs * layer.usedInputs);
+        for (int j{0}; j < layer.usedOutputs; ++j)
+            for (int k{0}; k < layer.usedInputs; ++k)
+                weights[j * layer.usedInputs + k] =
+                    layer.weights[j / kMlpBlock * kMlpBlock * layer.inputs +
+                                  k * kMlpBlock + j % kMlpBlock];
+
+        ok = ok && WriteWords(file, header, 3) &&
+             WriteWords(file, weights.data(),
+                        layer.usedOutputs * layer.usedInputs) &&
+             WriteWords(file, layer.bias.data(), layer.usedOutputs);
+    }
+
+    return std::fclose(file) == 0 && ok;
+} /* }}} */
+
+/* void SdlPong::Mlp::Forward {{{ */
+void SdlPong::Mlp::Forward(const float *inputs, int batch, float *outputs,
+                           MlpWorkspace &workspace, bool quantized) const {
+    assert(!mLayers.empty() && "No layers");
+    assert(batch >= 0 && "Negative batch");
+
+    // Copy the inputs into padded rows, with zeros in the padding
+    const SdlPong::MlpLayer &first{mLayers.front()};
+    workspace.a.assign(batch * first.inputs, 0.0f);
+    for (int i{0}; i < batch; ++i)
+        std::copy(inputs + i * first.usedInputs,
+                  inputs + (i + 1) * first.usedInputs,
+                  workspace.a.begin() + i * first.inputs);
+
+    // Every layer reads a and writes b. Padded outputs are zero, so they
+    // add nothing to the next layer.
+    for (const SdlPong::MlpLayer &layer : mLayers) {
+        workspace.b.resize(batch * layer.outputs);
+        if (quantized) {
+            workspace.quantized.resize(batch * layer.inputs);
+            workspace.scales.resize(batch);
+            QuantizeRows(workspace.a.data(), batch, layer.inputs,
+                         workspace.quantized.data(),
+                         workspace.scales.data());
+            mInt8Kernel(layer, workspace.quantized.data(),
+                        workspace.scales.data(), workspace.b.data(), 0,
+                        batch);
+        } else {
+            mFloatKernel(layer, workspace.a.data(), workspace.b.data(), 0,
+                         batch);
+        }
+        Activate(layer.activation, workspace.b.data(),
+                 batch * layer.outputs);
+        workspace.a.swap(workspace.b);
+    }
+
+    const SdlPong::MlpLayer &last{mLayers.back()};
+    for (int i{0}; i < batch; ++i)
+        std::copy(workspace.a.begin() + i * last.outputs,
+                  workspace.a.begin() + i * last.outputs + last.usedOutputs,
+                  outputs + i * last.usedOutputs);
+} /* }}} */
+
+int SdlPong::Mlp::getNumLayers() const {
+    return static_cast<int>(mLayers.size());
+}
+
+int SdlPong::Mlp::getInputSize() const {
+    return mLayers.empty() ? 0 : mLayers.front().usedInputs;
+}
+
+int SdlPong::Mlp::getOutputSize() const {
+    return mLayers.empty() ? 0 : mLayers.back().usedOutputs;
+}
+
+const char *SdlPong::Mlp::getKernelName() const { return mKernelName; }
@@ -0,0 +1,108 @@
+#ifndef _JC_MLP
+#define _JC_MLP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Small fully connected networks evaluated for a whole batch of inputs at
+// once, in float or with int8 weights and activations. Self-contained so
+// policies can be run on machines without any other ML runtime.
+
+namespace SdlPong {
+
+enum Activation { linearActivation, reluActivation, tanhActivation };
+
+constexpr int kNumActivations{tanhActivation + 1};
+
+// Outputs computed together by one pass of a kernel. Layer sizes are padded
+// to a multiple of this.
+constexpr int kMlpBlock{8};
+
+/* struct MlpLayer {{{
+ * One dense layer in the layout the kernels read.
+ * weights:  [outputs / kMlpBlock][inputs][kMlpBlock]
+ * qweights: [outputs / kMlpBlock][inputs / 2][kMlpBlock][2], each output
+ *           scaled by qscales so its largest weight maps to 127
+ * Padding weights and biases are zero.
+ * */
+struct MlpLayer {
+    int inputs;  // padded
+    int outputs; // padded
+    int usedInputs;
+    int usedOutputs;
+    Activation activation;
+
+    std::vector<float> weights;
+    std::vector<float> bias;
+    std::vector<std::int8_t> qweights;
+    std::vector<float> qscales;
+}; /* }}} */
+
+// Kernels computing rows [begin, end) of one layer before its activation.
+// Input rows are layer.inputs wide and output rows layer.outputs wide. The
+// int8 kernels take inputs quantized to [-127, 127], widened to int16 so
+// that pairs of them load as one word, and the scale of each row.
+void DenseFloatScalar(const MlpLayer &layer, const float *in, float *out,
+                      int begin, int end);
+void DenseInt8Scalar(const MlpLayer &layer, const std::int16_t *in,
+                     const float *inScales, float *out, int begin, int end);
+#ifdef PONG_HAVE_AVX2
+void DenseFloatAVX2(const MlpLayer &layer, const float *in, float *out,
+                    int begin, int end);
+void DenseInt8AVX2(const MlpLayer &layer, const std::int16_t *in,
+                   const float *inScales, float *out, int begin, int end);
+#endif
+
+// Scratch memory for Mlp::Forward, reused between calls to avoid
+// allocations. One per thread.
+struct MlpWorkspace {
+    std::vector<float> a;
+    std::vector<float> b;
+    std::vector<std::int16_t> quantized;
+    std::vector<float> scales;
+};
+
+class Mlp {
+
+  public:
+    Mlp();
+
+    // Append a layer. weights are row-major [outputs][inputs] and inputs
+    // must equal the outputs of the previous layer.
+    void addLayer(int inputs, int outputs, Activation activation,
+                  const float *weights, const float *bias);
+
+    // Weights file: "PONGMLP1", int32 layer count, then per layer int32
+    // inputs, outputs and activation followed by float32 weights
+    // [outputs][inputs] and bias [outputs], all little-endian
+    bool load(const std::string &path);
+    bool save(const std::string &path) const;
+
+    // Evaluate batch rows of getInputSize() floats into rows of
+    // getOutputSize() floats. quantized runs the int8 path.
+    void Forward(const float *inputs, int batch, float *outputs,
+                 MlpWorkspace &workspace, bool quantized = false) const;
+
+    int getNumLayers() const;
+    int getInputSize() const;
+    int getOutputSize() const;
+    // Name of the kernel picked for this CPU
+    const char *getKernelName() const;
+
+  private:
+    using FloatKernel = void (*)(const MlpLayer &, const float *, float *,
+                                 int, int);
+    using Int8Kernel = void (*)(const MlpLayer &, const std::int16_t *,
+                                const float *, float *, int, int);
+
+    std::vector<MlpLayer> mLayers;
+
+    FloatKernel mFloatKernel;
+    Int8Kernel mInt8Kernel;
+    const char *mKernelName;
+};
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_MLP */
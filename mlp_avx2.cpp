@@ -0,0 +1,41 @@
+// Compiled with -mavx2 -mfma; only called after a runtime CPU check
+#include "mlp.hpp"
+#include "mlp_kernel.hpp"
+#include <cstring>
+#include <immintrin.h>
+
+namespace {
+
+struct AVX2Ops {
+    using F = __m256;
+    using I = __m256i;
+
+    static F load(const float *p) { return _mm256_loadu_ps(p); }
+    static void store(float *p, F v) { _mm256_storeu_ps(p, v); }
+    static F set1(float v) { return _mm256_set1_ps(v); }
+    static F fmadd(F a, F b, F c) { return _mm256_fmadd_ps(a, b, c); }
+    static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static F toFloat(I v) { return _mm256_cvtepi32_ps(v); }
+    static I izero() { return _mm256_setzero_si256(); }
+    static I madd2(I acc, const std::int8_t *w, const std::int16_t *x) {
+        std::int32_t pair;
+        std::memcpy(&pair, x, sizeof(pair));
+        I w16{_mm256_cvtepi8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(w)))};
+        return _mm256_add_epi32(
+            acc, _mm256_madd_epi16(w16, _mm256_set1_epi32(pair)));
+    }
+};
+
+} // namespace
+
+void SdlPong::DenseFloatAVX2(const MlpLayer &layer, const float *in,
+                             float *out, int begin, int end) {
+    SdlPong::DenseFloatLanes<AVX2Ops>(layer, in, out, begin, end);
+}
+
+void SdlPong::DenseInt8AVX2(const MlpLayer &layer, const std::int16_t *in,
+                            const float *inScales, float *out, int begin,
+                            int end) {
+    SdlPong::DenseInt8Lanes<AVX2Ops>(layer, in, inScales, out, begin, end);
+}
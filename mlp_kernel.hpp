@@ -0,0 +1,108 @@
+#ifndef _JC_MLP_KERNEL
+#define _JC_MLP_KERNEL
+
+#include "mlp.hpp"
+
+// Dense layer kernels written once against a small set of operations on
+// kMlpBlock lanes. Each kernel translation unit includes this with its own
+// Ops and its own instruction set flags.
+//
+// Ops provides a float vector F and an int32 vector I of kMlpBlock lanes:
+//   load, store, set1, fmadd(a, b, c) = a * b + c, mul, toFloat, izero and
+//   madd2(acc, w, x) adding w[2j] * x[0] + w[2j + 1] * x[1] to lane j, where
+//   w points at kMlpBlock pairs of int8 weights.
+
+namespace SdlPong {
+namespace {
+
+// Input rows evaluated together, so every weight loaded is used this many
+// times
+constexpr int kMlpRows{8};
+
+/* template <typename Ops, int Rows> void DenseFloatRows {{{
+ * out[r] = in[r] * W + bias for Rows rows starting at in and out.
+ * */
+template <typename Ops, int Rows>
+void DenseFloatRows(const MlpLayer &layer, const float *in, float *out) {
+    using F = typename Ops::F;
+
+    for (int block{0}; block < layer.outputs; block += kMlpBlock) {
+        const float *w{layer.weights.data() + block * layer.inputs};
+
+        F acc[Rows];
+        for (int r{0}; r < Rows; ++r)
+            acc[r] = Ops::load(layer.bias.data() + block);
+
+        for (int k{0}; k < layer.inputs; ++k) {
+            F wk{Ops::load(w + k * kMlpBlock)};
+            for (int r{0}; r < Rows; ++r)
+                acc[r] = Ops::fmadd(Ops::set1(in[r * layer.inputs + k]), wk,
+                                    acc[r]);
+        }
+
+        for (int r{0}; r < Rows; ++r)
+            Ops::store(out + r * layer.outputs + block, acc[r]);
+    }
+} /* }}} */
+
+template <typename Ops>
+void DenseFloatLanes(const MlpLayer &layer, const float *in, float *out,
+                     int begin, int end) {
+    int i{begin};
+    for (; i + kMlpRows <= end; i += kMlpRows)
+        DenseFloatRows<Ops, kMlpRows>(layer, in + i * layer.inputs,
+                                      out + i * layer.outputs);
+    for (; i < end; ++i)
+        DenseFloatRows<Ops, 1>(layer, in + i * layer.inputs,
+                               out + i * layer.outputs);
+}
+
+/* template <typename Ops, int Rows> void DenseInt8Rows {{{
+ * Same as DenseFloatRows on quantized inputs, accumulating exactly in int32
+ * and scaling back to float once per output.
+ * */
+template <typename Ops, int Rows>
+void DenseInt8Rows(const MlpLayer &layer, const std::int16_t *in,
+                   const float *inScales, float *out) {
+    using F = typename Ops::F;
+    using I = typename Ops::I;
+
+    for (int block{0}; block < layer.outputs; block += kMlpBlock) {
+        const std::int8_t *w{layer.qweights.data() + block * layer.inputs};
+
+        I acc[Rows];
+        for (int r{0}; r < Rows; ++r)
+            acc[r] = Ops::izero();
+
+        for (int k{0}; k < layer.inputs; k += 2) {
+            const std::int8_t *wk{w + k * kMlpBlock};
+            for (int r{0}; r < Rows; ++r)
+                acc[r] = Ops::madd2(acc[r], wk, in + r * layer.inputs + k);
+        }
+
+        F scales{Ops::load(layer.qscales.data() + block)};
+        F bias{Ops::load(layer.bias.data() + block)};
+        for (int r{0}; r < Rows; ++r)
+            Ops::store(out + r * layer.outputs + block,
+                       Ops::fmadd(Ops::toFloat(acc[r]),
+                                  Ops::mul(scales, Ops::set1(inScales[r])),
+                                  bias));
+    }
+} /* }}} */
+
+template <typename Ops>
+void DenseInt8Lanes(const MlpLayer &layer, const std::int16_t *in,
+                    const float *inScales, float *out, int begin, int end) {
+    int i{begin};
+    for (; i + kMlpRows <= end; i += kMlpRows)
+        DenseInt8Rows<Ops, kMlpRows>(layer, in + i * layer.inputs,
+                                     inScales + i, out + i * layer.outputs);
+    for (; i < end; ++i)
+        DenseInt8Rows<Ops, 1>(layer, in + i * layer.inputs, inScales + i,
+                              out + i * layer.outputs);
+}
+
+} // namespace
+} // namespace SdlPong
+
+#endif /* ifndef _JC_MLP_KERNEL */
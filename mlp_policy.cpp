@@ -0,0 +1,138 @@
+#include "mlp_policy.hpp"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+// Everything Observe needs, in Simulation units
+struct RawObservation {
+    int width;
+    int height;
+    int barVel;
+    int barH;
+    int ballX;
+    int ballY;
+    int ballXvel;
+    int ballYvel;
+    int ownBarY;
+    int otherBarY;
+};
+
+/* void Featurize {{{
+ * Mirror the match for the right side so x always grows away from the
+ * observer
+ * */
+void Featurize(const RawObservation &raw, SdlPong::Side side, float *out) {
+    float invWidth{1.0f / static_cast<float>(raw.width)};
+    float invHeight{1.0f / static_cast<float>(raw.height)};
+    float invVel{1.0f / static_cast<float>(std::max(raw.barVel, 1))};
+    bool mirror{side == SdlPong::right};
+
+    out[0] = static_cast<float>(mirror ? raw.width - raw.ballX : raw.ballX) *
+             invWidth;
+    out[1] = static_cast<float>(raw.ballY) * invHeight;
+    out[2] = static_cast<float>(mirror ? -raw.ballXvel : raw.ballXvel) *
+             invVel;
+    out[3] = static_cast<float>(raw.ballYvel) * invVel;
+    out[4] = static_cast<float>(raw.ownBarY) * invHeight;
+    out[5] = static_cast<float>(raw.otherBarY) * invHeight;
+    out[6] = static_cast<float>(raw.ballY - raw.ownBarY - raw.barH / 2) *
+             invHeight;
+    out[7] = 1.0f;
+} /* }}} */
+
+SdlPong::BarDirection BestAction(const float *scores) {
+    return static_cast<SdlPong::BarDirection>(
+        std::max_element(scores, scores + SdlPong::kNumMlpActions) - scores);
+}
+
+// BatchEnv actions indexed by BarDirection
+constexpr std::int8_t kBatchActions[SdlPong::kNumMlpActions]{-1, 1, 0};
+
+} // namespace
+
+/* void SdlPong::Observe(const Simulation &sim, ...) {{{ */
+void SdlPong::Observe(const Simulation &sim, Side side, float *out) {
+    SdlPong::Rect ball{sim.getGraphicBox(SdlPong::ball).rect};
+    SdlPong::RigidBody vel{sim.getVel(SdlPong::ball)};
+    SdlPong::Rect leftBar{sim.getGraphicBox(SdlPong::leftBar).rect};
+    SdlPong::Rect rightBar{sim.getGraphicBox(SdlPong::rightBar).rect};
+    bool isLeft{side == SdlPong::left};
+
+    RawObservation raw{
+        .width = sim.getGraphicBox(SdlPong::rightWall).rect.x,
+        .height = sim.getGraphicBox(SdlPong::bottomWall).rect.y,
+        .barVel = sim.getBarVel(),
+        .barH = leftBar.h,
+        .ballX = ball.x,
+        .ballY = ball.y,
+        .ballXvel = vel.xvel,
+        .ballYvel = vel.yvel,
+        .ownBarY = isLeft ? leftBar.y : rightBar.y,
+        .otherBarY = isLeft ? rightBar.y : leftBar.y};
+    Featurize(raw, side, out);
+} /* }}} */
+
+/* void SdlPong::Observe(const BatchEnv &env, ...) {{{ */
+void SdlPong::Observe(const BatchEnv &env, int match, Side side,
+                      float *out) {
+    const SdlPong::BatchLayout &layout{env.getLayout()};
+    bool isLeft{side == SdlPong::left};
+
+    RawObservation raw{
+        .width = layout.rightWall.x,
+        .height = layout.bottomWall.y,
+        .barVel = layout.barVel,
+        .barH = layout.barH,
+        .ballX = env.ballX[match],
+        .ballY = env.ballY[match],
+        .ballXvel = env.ballXvel[match],
+        .ballYvel = env.ballYvel[match],
+        .ownBarY = isLeft ? env.leftBarY[match] : env.rightBarY[match],
+        .otherBarY = isLeft ? env.rightBarY[match] : env.leftBarY[match]};
+    Featurize(raw, side, out);
+} /* }}} */
+
+SdlPong::MlpPolicy::MlpPolicy(std::shared_ptr<const Mlp> net, bool quantized)
+    : mNet{std::move(net)}, mQuantized{quantized} {
+    assert(mNet->getInputSize() == kObservationSize &&
+           mNet->getOutputSize() == kNumMlpActions &&
+           "Network does not fit the policy");
+}
+
+SdlPong::BarDirection SdlPong::MlpPolicy::act(const Simulation &sim,
+                                               Side side) {
+    float observation[kObservationSize];
+    float scores[kNumMlpActions];
+    SdlPong::Observe(sim, side, observation);
+    mNet->Forward(observation, 1, scores, mWorkspace, mQuantized);
+    return BestAction(scores);
+}
+
+SdlPong::MlpBatchActor::MlpBatchActor(std::shared_ptr<const Mlp> net,
+                                      bool quantized)
+    : mNet{std::move(net)}, mQuantized{quantized} {
+    assert(mNet->getInputSize() == kObservationSize &&
+           mNet->getOutputSize() == kNumMlpActions &&
+           "Network does not fit the policy");
+}
+
+/* void SdlPong::MlpBatchActor::act {{{ */
+void SdlPong::MlpBatchActor::act(BatchEnv &env, Side side) {
+    int n{env.size()};
+    mObservations.resize(n * kObservationSize);
+    mScores.resize(n * kNumMlpActions);
+
+    for (int i{0}; i < n; ++i)
+        SdlPong::Observe(env, i, side,
+                         mObservations.data() + i * kObservationSize);
+
+    mNet->Forward(mObservations.data(), n, mScores.data(), mWorkspace,
+                  mQuantized);
+
+    std::vector<std::int8_t> &actions{side == SdlPong::left ? env.leftAction
+                                                            : env.rightAction};
+    for (int i{0}; i < n; ++i)
+        actions[i] =
+            kBatchActions[BestAction(mScores.data() + i * kNumMlpActions)];
+} /* }}} */
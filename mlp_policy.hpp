@@ -0,0 +1,60 @@
+#ifndef _JC_MLP_POLICY
+#define _JC_MLP_POLICY
+
+#include "batch_env.hpp"
+#include "mlp.hpp"
+#include "paddle_policy.hpp"
+#include <memory>
+
+// Paddle controllers backed by an Mlp. Networks see the match from their
+// own side, so one set of weights plays either bar, and answer with one
+// score per BarDirection; the highest score is played.
+
+namespace SdlPong {
+
+/* Observation {{{
+ * Features in order, with x measured away from the observer's own wall:
+ *   ball x and y, ball x and y velocity, own and opposing bar y, ball y
+ *   relative to the middle of the own bar, and a constant 1.
+ * Positions are fractions of the screen, velocities multiples of barVel.
+ * */
+constexpr int kObservationSize{8};
+constexpr int kNumMlpActions{none + 1};
+
+void Observe(const Simulation &sim, Side side, float *out);
+void Observe(const BatchEnv &env, int match, Side side, float *out);
+/* }}} */
+
+class MlpPolicy : public PaddlePolicy {
+  public:
+    // net takes kObservationSize inputs and gives kNumMlpActions outputs
+    MlpPolicy(std::shared_ptr<const Mlp> net, bool quantized = false);
+
+    BarDirection act(const Simulation &sim, Side side) override;
+
+  private:
+    std::shared_ptr<const Mlp> mNet;
+    bool mQuantized;
+    MlpWorkspace mWorkspace;
+};
+
+// Drives one side of every match in a BatchEnv with a single batched
+// evaluation per tick
+class MlpBatchActor {
+  public:
+    MlpBatchActor(std::shared_ptr<const Mlp> net, bool quantized = false);
+
+    // Fill env's actions for side
+    void act(BatchEnv &env, Side side);
+
+  private:
+    std::shared_ptr<const Mlp> mNet;
+    bool mQuantized;
+    MlpWorkspace mWorkspace;
+    std::vector<float> mObservations;
+    std::vector<float> mScores;
+};
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_MLP_POLICY */
@@ -0,0 +1,236 @@
+#include "netplay.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cassert>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// Packet layout, little endian:
+//   int32 inputs of the receiver the sender has
+//   int32 tick of the first input
+//   uint8 count, then count input bytes
+constexpr int kHeaderSize{9};
+
+void PutInt(std::uint8_t *out, std::int32_t value) {
+    std::uint32_t v{static_cast<std::uint32_t>(value)};
+    for (int i{0}; i < 4; ++i)
+        out[i] = static_cast<std::uint8_t>(v >> (8 * i));
+}
+
+std::int32_t GetInt(const std::uint8_t *in) {
+    std::uint32_t v{0};
+    for (int i{0}; i < 4; ++i)
+        v |= std::uint32_t{in[i]} << (8 * i);
+    return static_cast<std::int32_t>(v);
+}
+
+} // namespace
+
+SdlPong::UdpSocket::~UdpSocket() {
+    if (mFd >= 0)
+        close(mFd);
+}
+
+/* bool SdlPong::UdpSocket::open {{{ */
+bool SdlPong::UdpSocket::open(int localPort, const std::string &remoteHost,
+                              int remotePort) {
+    in_addr remote{};
+    if (inet_pton(AF_INET, remoteHost.c_str(), &remote) != 1)
+        return false;
+
+    mFd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (mFd < 0)
+        return false;
+
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(static_cast<std::uint16_t>(localPort));
+    if (bind(mFd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0 ||
+        fcntl(mFd, F_SETFL, fcntl(mFd, F_GETFL) | O_NONBLOCK) != 0) {
+        close(mFd);
+        mFd = -1;
+        return false;
+    }
+
+    mRemoteAddr = remote.s_addr;
+    mRemotePort = htons(static_cast<std::uint16_t>(remotePort));
+    return true;
+} /* }}} */
+
+void SdlPong::UdpSocket::send(const std::uint8_t *data, int size) {
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = mRemoteAddr;
+    to.sin_port = mRemotePort;
+    // Lost packets are covered by resending, so errors are ignored
+    sendto(mFd, data, size, 0, reinterpret_cast<sockaddr *>(&to), sizeof(to));
+}
+
+/* int SdlPong::UdpSocket::receive(std::uint8_t *buffer, int size) {{{ */
+int SdlPong::UdpSocket::receive(std::uint8_t *buffer, int size) {
+    while (true) {
+        sockaddr_in from{};
+        socklen_t fromSize{sizeof(from)};
+        ssize_t n{recvfrom(mFd, buffer, size, 0,
+                           reinterpret_cast<sockaddr *>(&from), &fromSize)};
+        if (n < 0)
+            return -1;
+        // Drop strays from anyone but the peer
+        if (from.sin_addr.s_addr == mRemoteAddr &&
+            from.sin_port == mRemotePort)
+            return static_cast<int>(n);
+    }
+} /* }}} */
+
+/* SdlPong::RollbackSession::RollbackSession {{{ */
+SdlPong::RollbackSession::RollbackSession(Simulation &sim, Side localSide,
+                                          UdpSocket &socket)
+    : mSim{sim}, mLocalSide{localSide}, mSocket{socket} {
+    // Human against human on both peers
+    mSim.startGame(false);
+}
+/* }}} */
+
+/* bool SdlPong::RollbackSession::step(BarDirection local) {{{ */
+bool SdlPong::RollbackSession::step(BarDirection local) {
+    Receive();
+    Resimulate();
+
+    // Too far ahead; a rollback could need a snapshot we no longer have
+    if (mTick - getConfirmedTick() >= kMaxRollbackTicks) {
+        Send();
+        return false;
+    }
+
+    mLocalInputs.push_back(static_cast<std::uint8_t>(local));
+    Send();
+
+    mUsedRemote.push_back(static_cast<std::uint8_t>(RemoteInput(mTick)));
+    Simulate(mTick);
+    ++mTick;
+    return true;
+} /* }}} */
+
+void SdlPong::RollbackSession::poll() {
+    Receive();
+    Resimulate();
+    Send();
+}
+
+int SdlPong::RollbackSession::getTick() const { return mTick; }
+
+int SdlPong::RollbackSession::getConfirmedTick() const {
+    int remote{static_cast<int>(mRemoteInputs.size())};
+    return remote < mTick ? remote : mTick;
+}
+
+int SdlPong::RollbackSession::getRollbacks() const { return mRollbacks; }
+
+int SdlPong::RollbackSession::getMaxResimulated() const {
+    return mMaxResimulated;
+}
+
+/* void SdlPong::RollbackSession::Receive() {{{ */
+void SdlPong::RollbackSession::Receive() {
+    std::uint8_t packet[kHeaderSize + 255];
+    int size;
+    while ((size = mSocket.receive(packet, sizeof(packet))) >= kHeaderSize) {
+        int ack{GetInt(packet)};
+        int first{GetInt(packet + 4)};
+        int count{packet[8]};
+        // Inputs past the next one we need are never taken, see below
+        if (count > size - kHeaderSize || first < 0 ||
+            first > static_cast<int>(mRemoteInputs.size()))
+            continue;
+        // Every input becomes a BarDirection; drop packets with any other
+        // value rather than take part of them
+        const auto invalid{
+            [](std::uint8_t input) { return input > SdlPong::none; }};
+        if (std::any_of(packet + kHeaderSize, packet + kHeaderSize + count,
+                        invalid))
+            continue;
+
+        if (ack > mRemoteAck && ack <= static_cast<int>(mLocalInputs.size()))
+            mRemoteAck = ack;
+
+        // Take inputs in order only; gaps are filled by later resends
+        for (int i{0}; i < count; ++i) {
+            int tick{first + i};
+            if (tick != static_cast<int>(mRemoteInputs.size()))
+                continue;
+            std::uint8_t input{packet[kHeaderSize + i]};
+            mRemoteInputs.push_back(input);
+
+            if (tick < mTick && mUsedRemote[tick] != input &&
+                (mRollbackTo < 0 || tick < mRollbackTo))
+                mRollbackTo = tick;
+        }
+    }
+} /* }}} */
+
+/* void SdlPong::RollbackSession::Send() {{{ */
+void SdlPong::RollbackSession::Send() {
+    // Everything the peer has not confirmed yet, oldest first
+    int first{mRemoteAck};
+    int count{static_cast<int>(mLocalInputs.size()) - first};
+    if (count > kMaxPacketInputs)
+        count = kMaxPacketInputs;
+
+    std::uint8_t packet[kHeaderSize + kMaxPacketInputs];
+    PutInt(packet, static_cast<std::int32_t>(mRemoteInputs.size()));
+    PutInt(packet + 4, first);
+    packet[8] = static_cast<std::uint8_t>(count);
+    for (int i{0}; i < count; ++i)
+        packet[kHeaderSize + i] = mLocalInputs[first + i];
+
+    mSocket.send(packet, kHeaderSize + count);
+} /* }}} */
+
+/* void SdlPong::RollbackSession::Resimulate() {{{
+ * Go back to the first tick that was run with a wrong guess and run every
+ * tick since with what is known now.
+ * */
+void SdlPong::RollbackSession::Resimulate() {
+    if (mRollbackTo < 0)
+        return;
+
+    assert(mTick - mRollbackTo <= kMaxRollbackTicks &&
+           "Rollback past the snapshot ring");
+
+    mSim.loadState(mSnapshots[mRollbackTo % (kMaxRollbackTicks + 1)]);
+    for (int tick{mRollbackTo}; tick < mTick; ++tick) {
+        mUsedRemote[tick] = static_cast<std::uint8_t>(RemoteInput(tick));
+        Simulate(tick);
+    }
+
+    ++mRollbacks;
+    if (mTick - mRollbackTo > mMaxResimulated)
+        mMaxResimulated = mTick - mRollbackTo;
+    mRollbackTo = -1;
+} /* }}} */
+
+/* void SdlPong::RollbackSession::Simulate(int tick) {{{ */
+void SdlPong::RollbackSession::Simulate(int tick) {
+    mSnapshots[tick % (kMaxRollbackTicks + 1)] = mSim.saveState();
+
+    BarDirection local{static_cast<BarDirection>(mLocalInputs[tick])};
+    BarDirection remote{static_cast<BarDirection>(mUsedRemote[tick])};
+    if (mLocalSide == SdlPong::left)
+        mSim.step({.left = local, .right = remote});
+    else
+        mSim.step({.left = remote, .right = local});
+} /* }}} */
+
+// The real input when it is known, otherwise the last one received
+SdlPong::BarDirection SdlPong::RollbackSession::RemoteInput(int tick) const {
+    if (tick < static_cast<int>(mRemoteInputs.size()))
+        return static_cast<BarDirection>(mRemoteInputs[tick]);
+    if (mRemoteInputs.empty())
+        return SdlPong::none;
+    return static_cast<BarDirection>(mRemoteInputs.back());
+}
@@ -0,0 +1,97 @@
+#ifndef _JC_NETPLAY
+#define _JC_NETPLAY
+
+#include "pong_sim.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Two-player rollback netplay. Each peer simulates every tick straight
+// away, guessing that the remote bar keeps doing what it last did. When
+// the real input arrives and differs, the match is rolled back to the
+// snapshot before that tick and simulated forward again.
+
+namespace SdlPong {
+
+/* class UdpSocket {{{
+ * Non-blocking IPv4 UDP socket that talks to a single peer.
+ * */
+class UdpSocket {
+  public:
+    UdpSocket() = default;
+    ~UdpSocket();
+
+    UdpSocket(const UdpSocket &) = delete;
+    UdpSocket &operator=(const UdpSocket &) = delete;
+
+    // Listen on localPort and send to remoteHost:remotePort, where
+    // remoteHost is a dotted IPv4 address
+    bool open(int localPort, const std::string &remoteHost, int remotePort);
+
+    void send(const std::uint8_t *data, int size);
+    // Size of the next datagram from the peer, or -1 if there is none
+    int receive(std::uint8_t *buffer, int size);
+
+  private:
+    int mFd{-1};
+    std::uint32_t mRemoteAddr{0}; // network byte order
+    std::uint16_t mRemotePort{0}; // network byte order
+}; /* }}} */
+
+/* class RollbackSession {{{
+ * Drives a Simulation for one local player against a remote peer running
+ * the same session for the other side. Both peers start the match on the
+ * first tick.
+ * */
+class RollbackSession {
+  public:
+    // Ticks a peer may run ahead of the last input it has from the other.
+    // Bounds both the snapshot ring and the work done by one rollback.
+    static constexpr int kMaxRollbackTicks{8};
+
+    RollbackSession(Simulation &sim, Side localSide, UdpSocket &socket);
+
+    // Advance one tick with the local player's input. Returns false, and
+    // does not advance, while waiting for the remote peer to catch up.
+    bool step(BarDirection local);
+    // Exchange inputs and correct mispredictions without advancing
+    void poll();
+
+    int getTick() const;
+    // Ticks for which both players' inputs are known
+    int getConfirmedTick() const;
+    int getRollbacks() const;
+    // Most ticks simulated again by a single rollback
+    int getMaxResimulated() const;
+
+  private:
+    // Most inputs resent in one packet
+    static constexpr int kMaxPacketInputs{64};
+
+    void Receive();
+    void Send();
+    void Resimulate();
+    void Simulate(int tick);
+    BarDirection RemoteInput(int tick) const;
+
+    Simulation &mSim;
+    Side mLocalSide;
+    UdpSocket &mSocket;
+
+    int mTick{0};
+    std::vector<std::uint8_t> mLocalInputs;
+    std::vector<std::uint8_t> mRemoteInputs; // confirmed, in tick order
+    std::vector<std::uint8_t> mUsedRemote;   // what each tick was run with
+    int mRemoteAck{0}; // local inputs the peer has confirmed
+
+    // State before tick t is at t % size
+    SimState mSnapshots[kMaxRollbackTicks + 1];
+    int mRollbackTo{-1};
+
+    int mRollbacks{0};
+    int mMaxResimulated{0};
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_NETPLAY */
@@ -0,0 +1,191 @@
+#include "paddle_policy.hpp"
+
+SdlPong::TrackingPolicy::TrackingPolicy(int deadZone, double missChance,
+                                        std::uint32_t seed)
+    : mDeadZone{deadZone}, mMiss{missChance}, mRng{seed} {}
+
+/* SdlPong::BarDirection SdlPong::TrackingPolicy::act {{{ */
+SdlPong::BarDirection SdlPong::TrackingPolicy::act(const Simulation &sim,
+                                                    Side side) {
+    if (mMiss(mRng))
+        return SdlPong::none;
+
+    // Chase where the ball will be after this tick's move, like the AI in
+    // Simulation::UpdatePositions
+    int ballY{sim.getGraphicBox(SdlPong::ball).rect.y +
+              sim.getVel(SdlPong::ball).yvel};
+    int barY{sim.getGraphicBox(side == SdlPong::left ? SdlPong::leftBar
+                                                     : SdlPong::rightBar)
+                 .rect.y};
+
+    if (ballY - barY > mDeadZone)
+        return SdlPong::down;
+    if (ballY - barY < -mDeadZone)
+        return SdlPong::up;
+    return SdlPong::none;
+} /* }}} */
+
+SdlPong::InterceptPolicy::InterceptPolicy(int reactionTicks, double aimError,
+                                          std::uint32_t seed)
+    : mReactionTicks{reactionTicks}, mAimError{aimError}, mRng{seed} {}
+
+/* SdlPong::InterceptPolicy::InterceptPolicy(AILevel level, ...) {{{ */
+SdlPong::InterceptPolicy::InterceptPolicy(AILevel level, std::uint32_t seed)
+    : InterceptPolicy{0, 0.0, seed} {
+    switch (level) {
+    case SdlPong::easyAI:
+        mReactionTicks = 20;
+        mAimError = 0.4;
+        break;
+    case SdlPong::normalAI:
+        mReactionTicks = 10;
+        mAimError = 0.25;
+        break;
+    case SdlPong::hardAI:
+        mReactionTicks = 4;
+        mAimError = 0.12;
+        break;
+    case SdlPong::perfectAI:
+        break;
+    }
+} /* }}} */
+
+/* SdlPong::BarDirection SdlPong::InterceptPolicy::act {{{ */
+SdlPong::BarDirection SdlPong::InterceptPolicy::act(const Simulation &sim,
+                                                     Side side) {
+    SdlPong::Rect ball{sim.getGraphicBox(SdlPong::ball).rect};
+    SdlPong::RigidBody vel{sim.getVel(SdlPong::ball)};
+
+    // A bounce changes the velocity; a serve also moves the ball somewhere
+    // its last velocity could not have taken it
+    if (!mPlanned || vel.xvel != mXvel || vel.yvel != mYvel ||
+        ball.x != mLastX + mXvel) {
+        mXvel = vel.xvel;
+        mYvel = vel.yvel;
+        mPlanned = true;
+        mReplan = true;
+        mReactLeft = mReactionTicks * sim.getTickRate() / kBaseTickRate;
+    }
+    mLastX = ball.x;
+
+    int barY{sim.getGraphicBox(side == SdlPong::left ? SdlPong::leftBar
+                                                     : SdlPong::rightBar)
+                 .rect.y};
+    if (!mHasTarget) {
+        mTargetY = barY;
+        mHasTarget = true;
+    }
+
+    // Keep following the old plan until the change is noticed
+    if (mReplan && mReactLeft-- <= 0) {
+        mTargetY = Intercept(sim, side);
+        mReplan = false;
+        ++mRecomputes;
+    }
+    if (std::optional<BarDirection> swing = Swing(sim, side))
+        return *swing;
+
+    // Within half a step of the target is close enough; avoids jitter
+    int deadZone{sim.getBarVel() / 2};
+    if (mTargetY - barY > deadZone)
+        return SdlPong::down;
+    if (mTargetY - barY < -deadZone)
+        return SdlPong::up;
+    return SdlPong::none;
+} /* }}} */
+
+int SdlPong::InterceptPolicy::getRecomputes() const { return mRecomputes; }
+
+/* std::optional<SdlPong::BarDirection> SdlPong::InterceptPolicy::Swing {{{
+ * The ball leaves a bar with the bar's vertical velocity, so one that is
+ * met standing still comes back flat and a bar that does not move returns
+ * it forever. On the tick of contact, move the bar away from the other
+ * bar's middle if the ball still lands on it.
+ * */
+std::optional<SdlPong::BarDirection>
+SdlPong::InterceptPolicy::Swing(const Simulation &sim, Side side) const {
+    SdlPong::Rect ball{sim.getGraphicBox(SdlPong::ball).rect};
+    SdlPong::RigidBody vel{sim.getVel(SdlPong::ball)};
+    SdlPong::Rect bar{sim.getGraphicBox(side == SdlPong::left
+                                            ? SdlPong::leftBar
+                                            : SdlPong::rightBar)
+                          .rect};
+    SdlPong::Rect other{sim.getGraphicBox(side == SdlPong::left
+                                              ? SdlPong::rightBar
+                                              : SdlPong::leftBar)
+                            .rect};
+
+    const long long nextX{static_cast<long long>(ball.x) + vel.xvel};
+    const bool contact{side == SdlPong::left
+                           ? vel.xvel < 0 && ball.x >= bar.x + bar.w &&
+                                 nextX < bar.x + bar.w
+                           : vel.xvel > 0 && ball.x + ball.w <= bar.x &&
+                                 nextX + ball.w > bar.x};
+    if (!contact)
+        return std::nullopt;
+
+    const long long ballMid{2LL * ball.y + ball.h};
+    const long long otherMid{2LL * other.y + other.h};
+    const BarDirection dir{ballMid < otherMid ? SdlPong::up : SdlPong::down};
+
+    const long long nextBallY{static_cast<long long>(ball.y) + vel.yvel};
+    const long long nextBarY{static_cast<long long>(bar.y) +
+                             (dir == SdlPong::up ? -sim.getBarVel()
+                                                 : sim.getBarVel())};
+    if (nextBallY + ball.h <= nextBarY || nextBallY >= nextBarY + bar.h)
+        return std::nullopt;
+    return dir;
+} /* }}} */
+
+/* int SdlPong::InterceptPolicy::Intercept {{{
+ * Bar y that centers the bar on where the ball will reach its face, or on
+ * the middle of the field if the ball is moving away.
+ * */
+int SdlPong::InterceptPolicy::Intercept(const Simulation &sim, Side side) {
+    SdlPong::Rect ball{sim.getGraphicBox(SdlPong::ball).rect};
+    SdlPong::RigidBody vel{sim.getVel(SdlPong::ball)};
+    SdlPong::Rect bar{sim.getGraphicBox(side == SdlPong::left
+                                            ? SdlPong::leftBar
+                                            : SdlPong::rightBar)
+                          .rect};
+    SdlPong::Rect top{sim.getGraphicBox(SdlPong::topWall).rect};
+    SdlPong::Rect bottom{sim.getGraphicBox(SdlPong::bottomWall).rect};
+
+    // Range of the ball's y between the walls
+    const long long lo{top.y + top.h};
+    const long long hi{bottom.y - ball.h};
+
+    bool approaching{side == SdlPong::left ? vel.xvel < 0 : vel.xvel > 0};
+    if (!approaching || hi <= lo)
+        return static_cast<int>((lo + bottom.y) / 2 - bar.h / 2);
+
+    // Ticks until the ball touches the bar's face
+    long long faceX{side == SdlPong::left ? bar.x + bar.w : bar.x - ball.w};
+    long long ticks{(faceX - ball.x) / vel.xvel};
+    if (ticks < 0)
+        ticks = 0;
+
+    // Unfold the wall bounces: the path is periodic with period 2 * span
+    // and mirrored in every other half
+    const long long span{hi - lo};
+    long long y{(ball.y - lo + vel.yvel * ticks) % (2 * span)};
+    if (y < 0)
+        y += 2 * span;
+    if (y > span)
+        y = 2 * span - y;
+    y += lo;
+
+    if (mAimError > 0)
+        y += static_cast<long long>(mError(mRng) * mAimError * bar.h);
+
+    long long target{y + ball.h / 2 - bar.h / 2};
+    long long minY{lo};
+    long long maxY{bottom.y - bar.h};
+    return static_cast<int>(target < minY   ? minY
+                            : target > maxY ? maxY
+                                            : target);
+} /* }}} */
+
+SdlPong::BarDirection SdlPong::IdlePolicy::act(const Simulation &, Side) {
+    return SdlPong::none;
+}
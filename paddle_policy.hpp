@@ -0,0 +1,100 @@
+#ifndef _JC_PADDLE_POLICY
+#define _JC_PADDLE_POLICY
+
+#include "pong_sim.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+
+namespace SdlPong {
+
+// Decides how a bar moves each tick. One instance drives one bar in one
+// match, so implementations may keep state between calls.
+class PaddlePolicy {
+  public:
+    virtual ~PaddlePolicy() = default;
+
+    // Called before every Simulation::step
+    virtual BarDirection act(const Simulation &sim, Side side) = 0;
+};
+
+// Creates a fresh policy for a match; seed varies between matches
+using PolicyFactory =
+    std::function<std::unique_ptr<PaddlePolicy>(std::uint32_t seed)>;
+
+/* class TrackingPolicy {{{
+ * The elementary AI: chase the ball's y position.
+ * deadZone:  distance in Simulation units within which the bar stays put
+ * missChance: probability of not reacting on a tick
+ * */
+class TrackingPolicy : public PaddlePolicy {
+  public:
+    TrackingPolicy(int deadZone = 0, double missChance = 0.0,
+                   std::uint32_t seed = 0);
+
+    BarDirection act(const Simulation &sim, Side side) override;
+
+  private:
+    int mDeadZone;
+    std::bernoulli_distribution mMiss;
+    std::minstd_rand mRng;
+}; /* }}} */
+
+enum AILevel { easyAI, normalAI, hardAI, perfectAI };
+
+/* class InterceptPolicy {{{
+ * Predictive AI: works out where the ball will cross the bar's face,
+ * folding its path at the top and bottom walls, and moves there. While the
+ * ball moves away the bar returns to the middle. The intercept is only
+ * recomputed when the ball's velocity changes or it is served, not every
+ * tick. It meets the ball moving, to send it back at an angle.
+ * reactionTicks: ticks at kBaseTickRate before a change is noticed
+ * aimError:      standard deviation of the aim, in bar heights
+ * */
+class InterceptPolicy : public PaddlePolicy {
+  public:
+    InterceptPolicy(int reactionTicks = 0, double aimError = 0.0,
+                    std::uint32_t seed = 0);
+    explicit InterceptPolicy(AILevel level, std::uint32_t seed = 0);
+
+    BarDirection act(const Simulation &sim, Side side) override;
+
+    // Intercepts computed so far
+    int getRecomputes() const;
+
+  private:
+    int Intercept(const Simulation &sim, Side side);
+    // Direction to hit the ball with, on the tick the bar meets it
+    std::optional<BarDirection> Swing(const Simulation &sim,
+                                      Side side) const;
+
+    int mReactionTicks;
+    double mAimError;
+    std::normal_distribution<double> mError{0.0, 1.0};
+    std::minstd_rand mRng;
+
+    // Ball motion the cached target was planned for
+    int mXvel{0};
+    int mYvel{0};
+    int mLastX{0};
+    bool mPlanned{false};
+
+    int mReactLeft{0}; // ticks until the next plan is made
+    bool mReplan{true};
+    // Until the first plan the bar holds where it starts
+    bool mHasTarget{false};
+    int mTargetY{0};
+    int mRecomputes{0};
+}; /* }}} */
+
+// Never moves
+class IdlePolicy : public PaddlePolicy {
+  public:
+    BarDirection act(const Simulation &sim, Side side) override;
+};
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_PADDLE_POLICY */
@@ -0,0 +1,101 @@
+#include "particle_system.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numbers>
+
+SdlPong::ParticleSystem::ParticleSystem(int capacity, std::uint32_t seed)
+    : mCapacity{capacity}, mX(capacity), mY(capacity), mXvel(capacity),
+      mYvel(capacity), mLife(capacity), mColor(capacity),
+      mCorners(static_cast<std::size_t>(capacity) * 4), mRng{seed} {
+    assert(capacity >= 0 && "Negative capacity");
+}
+
+/* void SdlPong::ParticleSystem::Burst {{{ */
+void SdlPong::ParticleSystem::Burst(float x, float y, int count, float speed,
+                                    SDL_FColor color) {
+    std::uniform_real_distribution<float> angle{
+        0.0f, 2.0f * std::numbers::pi_v<float>};
+    std::uniform_real_distribution<float> fraction{0.2f, 1.0f};
+
+    count = std::min(count, mCapacity - mCount);
+    for (int n{0}; n < count; ++n, ++mCount) {
+        const float a{angle(mRng)};
+        const float v{speed * fraction(mRng)};
+        mX[mCount] = x;
+        mY[mCount] = y;
+        mXvel[mCount] = v * std::cos(a);
+        mYvel[mCount] = v * std::sin(a);
+        // Stagger lifetimes so a burst thins out instead of vanishing
+        mLife[mCount] = fraction(mRng);
+        mColor[mCount] = color;
+    }
+} /* }}} */
+
+/* void SdlPong::ParticleSystem::Update(float seconds) {{{ */
+void SdlPong::ParticleSystem::Update(float seconds) {
+    const float drag{std::max(0.0f, 1.0f - kDrag * seconds)};
+    const float fall{kGravity * seconds};
+    const float fade{seconds / kLifetime};
+
+    float *x{mX.data()};
+    float *y{mY.data()};
+    float *xvel{mXvel.data()};
+    float *yvel{mYvel.data()};
+    float *life{mLife.data()};
+
+    // Straight-line arithmetic on packed floats, vectorized by the compiler
+    for (int i{0}; i < mCount; ++i) {
+        xvel[i] *= drag;
+        yvel[i] = yvel[i] * drag + fall;
+        x[i] += xvel[i] * seconds;
+        y[i] += yvel[i] * seconds;
+        life[i] -= fade;
+    }
+
+    // Swap the last live particle into every dead slot
+    for (int i{0}; i < mCount;) {
+        if (life[i] > 0.0f) {
+            ++i;
+            continue;
+        }
+        --mCount;
+        x[i] = x[mCount];
+        y[i] = y[mCount];
+        xvel[i] = xvel[mCount];
+        yvel[i] = yvel[mCount];
+        life[i] = life[mCount];
+        mColor[i] = mColor[mCount];
+    }
+} /* }}} */
+
+/* void SdlPong::ParticleSystem::Render {{{ */
+void SdlPong::ParticleSystem::Render(RenderQueue &queue, RenderLayer layer) {
+    constexpr float half{kSize / 2};
+
+    // Texture coordinates stay zero from construction, so only positions
+    // and colors are written
+    SDL_Vertex *corner{mCorners.data()};
+    for (int i{0}; i < mCount; ++i, corner += 4) {
+        SDL_FColor color{mColor[i]};
+        color.a *= mLife[i];
+        const float x0{mX[i] - half};
+        const float y0{mY[i] - half};
+        const float x1{mX[i] + half};
+        const float y1{mY[i] + half};
+        corner[0].position = {x0, y0};
+        corner[1].position = {x1, y0};
+        corner[2].position = {x1, y1};
+        corner[3].position = {x0, y1};
+        for (int k{0}; k < 4; ++k)
+            corner[k].color = color;
+    }
+
+    queue.AddQuadBatch(mCorners.data(), mCount, layer);
+} /* }}} */
+
+void SdlPong::ParticleSystem::clear() { mCount = 0; }
+
+int SdlPong::ParticleSystem::size() const { return mCount; }
+
+int SdlPong::ParticleSystem::getCapacity() const { return mCapacity; }
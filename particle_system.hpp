@@ -0,0 +1,65 @@
+#ifndef _JC_PARTICLE_SYSTEM
+#define _JC_PARTICLE_SYSTEM
+
+#include "render_queue.hpp"
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace SdlPong {
+
+/* class ParticleSystem {{{
+ * Short-lived squares thrown out by impacts, kept in a pool of fixed
+ * capacity. Every field lives in its own packed array. Live particles
+ * occupy the front of the arrays and a dead one is replaced by the last,
+ * so nothing is allocated after construction. Update is one branch-free
+ * pass over the arrays that the compiler vectorizes. Render hands every
+ * particle to the RenderQueue as a single batch.
+ * */
+class ParticleSystem {
+  public:
+    static constexpr int kDefaultCapacity{1 << 16};
+
+    explicit ParticleSystem(int capacity = kDefaultCapacity,
+                            std::uint32_t seed = 0);
+
+    // Throw count particles out of (x, y), in pixels, at up to speed pixels
+    // per second. Particles that do not fit in the pool are dropped.
+    void Burst(float x, float y, int count, float speed, SDL_FColor color);
+
+    // Advance every particle by seconds and retire the ones that faded out
+    void Update(float seconds);
+
+    // Queue every live particle, fading with age
+    void Render(RenderQueue &queue, RenderLayer layer = gameLayer);
+
+    void clear();
+    int size() const;
+    int getCapacity() const;
+
+  private:
+    static constexpr float kLifetime{0.6f};  // seconds
+    static constexpr float kGravity{500.0f}; // pixels per second squared
+    static constexpr float kDrag{2.5f};      // speed lost per second
+    static constexpr float kSize{3.0f};      // pixels
+
+    int mCapacity;
+    int mCount{0};
+
+    std::vector<float> mX;
+    std::vector<float> mY;
+    std::vector<float> mXvel;
+    std::vector<float> mYvel;
+    std::vector<float> mLife; // from 1 when spawned down to 0
+    std::vector<SDL_FColor> mColor;
+
+    // Four corners per live particle, rebuilt by every Render
+    std::vector<SDL_Vertex> mCorners;
+
+    std::minstd_rand mRng;
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_PARTICLE_SYSTEM */
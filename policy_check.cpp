@@ -0,0 +1,57 @@
+#include "match_farm.hpp"
+#include "paddle_policy.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+// Sanity checks of the built-in paddle AIs, run by ctest: every intercept
+// level must beat a bar that never moves, from either side
+
+namespace {
+
+constexpr int kMatches{20};
+
+// Matches level wins against IdlePolicy, playing side
+int WinsAgainstIdle(SdlPong::AILevel level, SdlPong::Side side) {
+    SdlPong::FarmConfig config;
+    int wins{0};
+    for (int m{0}; m < kMatches; ++m) {
+        SdlPong::InterceptPolicy intercept{level,
+                                           static_cast<std::uint32_t>(m)};
+        SdlPong::IdlePolicy idle;
+        SdlPong::MatchResult result{
+            side == SdlPong::left
+                ? SdlPong::PlayMatch(config, intercept, idle)
+                : SdlPong::PlayMatch(config, idle, intercept)};
+        const int own{side == SdlPong::left ? result.leftScore
+                                            : result.rightScore};
+        if (own == config.pointsToWin)
+            ++wins;
+    }
+    return wins;
+}
+
+} // namespace
+
+int main() {
+    static const struct {
+        const char *name;
+        SdlPong::AILevel level;
+    } levels[] = {{"easy", SdlPong::easyAI},
+                  {"normal", SdlPong::normalAI},
+                  {"hard", SdlPong::hardAI},
+                  {"perfect", SdlPong::perfectAI}};
+
+    bool ok{true};
+    for (const auto &entry : levels) {
+        for (SdlPong::Side side : {SdlPong::left, SdlPong::right}) {
+            const int wins{WinsAgainstIdle(entry.level, side)};
+            std::printf("%-8s %-5s %2d/%d wins against idle\n", entry.name,
+                        side == SdlPong::left ? "left" : "right", wins,
+                        kMatches);
+            // A clear majority; a lost match now and then is fine
+            if (wins * 4 < kMatches * 3)
+                ok = false;
+        }
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
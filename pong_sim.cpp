@@ -0,0 +1,467 @@
+#include "pong_sim.hpp"
+#include "collision_response.hpp"
+#include <cassert>
+#include <initializer_list>
+#include <utility>
+
+/* SdlPong::Simulation::Simulation {{{ */
+SdlPong::Simulation::Simulation(int tickRate)
+    : mAI{false}, mTickRate{tickRate},
+      barVel{FixedScale(ToFixed(kWorldHeight), kBaseTickRate,
+                        std::int64_t{75} * tickRate)},
+      mLeftScore{-1}, mRightScore{-1}, mBall{}, mLeftBar{}, mRightBar{}, mTopWall{}, mBottomWall{},
+      mLeftWall{}, mRightWall{} {
+
+    assert(tickRate > 0 && "Tick rate must be positive");
+
+    // Dimensions based on the size of the field
+    const SdlPong::Fixed worldW{ToFixed(kWorldWidth)};
+    const SdlPong::Fixed worldH{ToFixed(kWorldHeight)};
+    const SdlPong::Fixed padding{ToFixed(kPadding)};
+
+    SdlPong::Fixed ballW{worldW / 25};
+    SdlPong::Fixed ballH{ballW};
+
+    SdlPong::Fixed barH{worldH / 6};
+    SdlPong::Fixed barW{ballW};
+
+    SdlPong::Fixed TBwallH{padding};
+    SdlPong::Fixed TBwallW{worldW};
+
+    SdlPong::Fixed sideWallH{worldH};
+    SdlPong::Fixed sideWallW{padding};
+
+    SdlPong::Color white{0xFF, 0xFF, 0xFF, 0xFF};
+    SdlPong::RigidBody stationery{.xvel = 0, .yvel = 0};
+
+    // Ball is in the middle of the field
+    SdlPong::Rect ballRect{.x = worldW / 2 - ballW / 2,
+                           .y = worldH / 2 - ballW / 2,
+                           .w = ballW,
+                           .h = ballH};
+    SdlPong::GraphicBox ballBox{.rect = ballRect, .color = white};
+
+    SdlPong::Rect leftBarRect{
+        .x = 0, .y = worldH / 2 - barH / 2, .w = barW, .h = barH};
+    SdlPong::GraphicBox leftBarBox{.rect = leftBarRect, .color = white};
+    SdlPong::Rect rightBarRect{
+        .x = worldW - barW, .y = worldH / 2 - barH / 2, .w = barW, .h = barH};
+    SdlPong::GraphicBox rightBarBox{.rect = rightBarRect, .color = white};
+
+    SdlPong::Rect topWallRect{
+        .x = 0, .y = -padding, .w = TBwallW, .h = TBwallH};
+    SdlPong::GraphicBox topWallBox{.rect = topWallRect, .color = white};
+    SdlPong::Rect bottomWallRect{
+        .x = 0, .y = worldH, .w = TBwallW, .h = TBwallH};
+    SdlPong::GraphicBox bottomWallBox{.rect = bottomWallRect, .color = white};
+
+    SdlPong::Rect leftWallRect{
+        .x = -padding, .y = 0, .w = sideWallW, .h = sideWallH};
+    SdlPong::GraphicBox leftWallBox{.rect = leftWallRect, .color = white};
+    SdlPong::Rect rightWallRect{
+        .x = worldW, .y = 0, .w = sideWallW, .h = sideWallH};
+    SdlPong::GraphicBox rightWallBox{.rect = rightWallRect, .color = white};
+
+    // Added in Id order so that mBodies can be indexed by Id
+    mBall = mEntities.add(ballBox, stationery, SdlPong::ball);
+    mLeftBar = mEntities.add(leftBarBox, stationery, SdlPong::leftBar);
+    mRightBar = mEntities.add(rightBarBox, stationery, SdlPong::rightBar);
+
+    mTopWall = mEntities.add(topWallBox, stationery, SdlPong::topWall);
+    mBottomWall =
+        mEntities.add(bottomWallBox, stationery, SdlPong::bottomWall);
+    mLeftWall = mEntities.add(leftWallBox, stationery, SdlPong::leftWall);
+    mRightWall = mEntities.add(rightWallBox, stationery, SdlPong::rightWall);
+
+    mBodies[SdlPong::ball] = mBall;
+    mBodies[SdlPong::leftBar] = mLeftBar;
+    mBodies[SdlPong::rightBar] = mRightBar;
+    mBodies[SdlPong::topWall] = mTopWall;
+    mBodies[SdlPong::bottomWall] = mBottomWall;
+    mBodies[SdlPong::leftWall] = mLeftWall;
+    mBodies[SdlPong::rightWall] = mRightWall;
+}
+/* }}} */
+
+void SdlPong::Simulation::startGame(bool ai) {
+    mAI = ai;
+    mEntities.reset(mBall);
+    mEntities.setVel(mBall, {.xvel = barVel, .yvel = 0});
+    mLeftScore = 0;
+    mRightScore = 0;
+}
+
+void SdlPong::Simulation::incScore(SdlPong::Side side) {
+    if (side == SdlPong::left)
+        ++mLeftScore;
+    else if (side == SdlPong::right)
+        ++mRightScore;
+}
+
+void SdlPong::Simulation::decScore(SdlPong::Side side) {
+    if (side == SdlPong::left)
+        --mLeftScore;
+    else if (side == SdlPong::right)
+        --mRightScore;
+}
+
+void SdlPong::Simulation::moveBar(SdlPong::Side side,
+                                  SdlPong::BarDirection dir) {
+    SdlPong::RigidBody newRb{0, 0};
+    switch (dir) {
+    case SdlPong::up:
+        newRb.yvel = -barVel;
+        break;
+    case SdlPong::down:
+        newRb.yvel = barVel;
+        break;
+    case SdlPong::none:
+        newRb.yvel = 0;
+        break;
+    default:
+        assert(false && "Invaild direction");
+    }
+    if (side == SdlPong::left && (!mAI))
+        mEntities.setVel(mLeftBar, newRb);
+    else if (side == SdlPong::right)
+        mEntities.setVel(mRightBar, newRb);
+}
+
+/* void SdlPong::Simulation::step(const SdlPong::Inputs &inputs) {{{ */
+void SdlPong::Simulation::step(const SdlPong::Inputs &inputs) {
+    mImpacts.clear();
+    moveBar(SdlPong::left, inputs.left);
+    moveBar(SdlPong::right, inputs.right);
+
+    {
+        SdlPong::ProfileScope scope{mProfiler, SdlPong::updatePositionsPhase};
+        UpdatePositions();
+    }
+    {
+        SdlPong::ProfileScope scope{mProfiler, SdlPong::checkCollisionsPhase};
+        CheckCollisions();
+    }
+    {
+        SdlPong::ProfileScope scope{mProfiler,
+                                    SdlPong::processCollisionsPhase};
+        ProcessCollisions();
+    }
+} /* }}} */
+
+const std::vector<SdlPong::Impact> &
+SdlPong::Simulation::getImpacts() const {
+    return mImpacts;
+}
+
+void SdlPong::Simulation::AddImpact(ImpactKind kind, Entity ball, Id other) {
+    mImpacts.push_back({.kind = kind,
+                        .other = other,
+                        .x = mEntities.x[ball] + mEntities.w[ball] / 2,
+                        .y = mEntities.y[ball] + mEntities.h[ball] / 2});
+}
+
+int SdlPong::Simulation::getScore(SdlPong::Side side) const {
+    return side == SdlPong::left ? mLeftScore : mRightScore;
+}
+
+bool SdlPong::Simulation::isAI() const { return mAI; }
+
+int SdlPong::Simulation::getTickRate() const { return mTickRate; }
+
+int SdlPong::Simulation::getBarVel() const { return barVel; }
+
+SdlPong::GraphicBox SdlPong::Simulation::getGraphicBox(SdlPong::Id id) const {
+    return mEntities.graphicBox(mBodies[id]);
+}
+
+SdlPong::RigidBody SdlPong::Simulation::getVel(SdlPong::Id id) const {
+    return mEntities.vel(mBodies[id]);
+}
+
+/* void SdlPong::Simulation::UpdatePositions() {{{ */
+void SdlPong::Simulation::UpdatePositions() {
+    if (mAI) { // elementary AI
+        // Chase where the ball will be after this tick's move
+        int ballY{mEntities.y[mBall] + mEntities.yvel[mBall]};
+        SdlPong::RigidBody newRb{0, 0};
+        if (ballY - mEntities.y[mLeftBar] > 0)
+            newRb.yvel = barVel;
+        else if (ballY - mEntities.y[mLeftBar] < 0)
+            newRb.yvel = -barVel;
+        else
+            newRb.yvel = 0;
+        mEntities.setVel(mLeftBar, newRb);
+    }
+
+    if (!mContinuous) {
+        mEntities.UpdatePositions();
+        return;
+    }
+
+    // Bars and walls move as usual, balls are then swept from where they
+    // started
+    mSweepStartX.assign(mEntities.x.begin(), mEntities.x.end());
+    mSweepStartY.assign(mEntities.y.begin(), mEntities.y.end());
+    mEntities.UpdatePositions();
+    for (Entity e{0}; e < mEntities.size(); ++e) {
+        if (mEntities.id[e] == SdlPong::ball)
+            SweepBall(e, mSweepStartX[e], mSweepStartY[e]);
+    }
+} /* }}} */
+
+void SdlPong::Simulation::setContinuousCollisions(bool enabled) {
+    mContinuous = enabled;
+}
+
+void SdlPong::Simulation::setProfiler(SdlPong::Profiler *profiler) {
+    mProfiler = profiler;
+}
+
+/* SdlPong::SimState SdlPong::Simulation::saveState() const {{{ */
+SdlPong::SimState SdlPong::Simulation::saveState() const {
+    SdlPong::SimState state{};
+    state.ai = mAI;
+    state.continuous = mContinuous;
+    state.leftScore = mLeftScore;
+    state.rightScore = mRightScore;
+    for (int id{0}; id < kNumIds; ++id) {
+        Entity e{mBodies[id]};
+        state.x[id] = mEntities.x[e];
+        state.y[id] = mEntities.y[e];
+        state.xvel[id] = mEntities.xvel[e];
+        state.yvel[id] = mEntities.yvel[e];
+    }
+    return state;
+} /* }}} */
+
+/* void SdlPong::Simulation::loadState(const SdlPong::SimState &state) {{{ */
+void SdlPong::Simulation::loadState(const SdlPong::SimState &state) {
+    mAI = state.ai != 0;
+    mContinuous = state.continuous != 0;
+    mLeftScore = state.leftScore;
+    mRightScore = state.rightScore;
+    for (int id{0}; id < kNumIds; ++id) {
+        Entity e{mBodies[id]};
+        mEntities.x[e] = state.x[id];
+        mEntities.y[e] = state.y[id];
+        mEntities.xvel[e] = state.xvel[id];
+        mEntities.yvel[e] = state.yvel[id];
+        // Responses never outlive a tick
+        mEntities.collided[e] = false;
+    }
+    mImpacts.clear();
+} /* }}} */
+
+namespace {
+
+// num / den with den > 0. den == 0 stands for minus infinity when num < 0
+// and plus infinity otherwise.
+struct Fraction {
+    long long num;
+    long long den;
+};
+
+bool Less(Fraction a, Fraction b) {
+    if (a.den == 0 || b.den == 0) {
+        int rankA{a.den != 0 ? 0 : (a.num < 0 ? -1 : 1)};
+        int rankB{b.den != 0 ? 0 : (b.num < 0 ? -1 : 1)};
+        return rankA < rankB;
+    }
+    return a.num * b.den < b.num * a.den;
+}
+
+/* bool AxisTimes {{{
+ * Times, as fractions of the move, at which a box at p of size s moving by d
+ * starts and stops overlapping a box at q of size r along one axis. Returns
+ * false if they never overlap.
+ * */
+bool AxisTimes(long long p, long long s, long long d, long long q,
+               long long r, Fraction &entry, Fraction &exit) {
+    if (d > 0) {
+        entry = {q - (p + s), d};
+        exit = {q + r - p, d};
+    } else if (d < 0) {
+        entry = {p - (q + r), -d};
+        exit = {p + s - q, -d};
+    } else if (p < q + r && q < p + s) {
+        entry = {-1, 0};
+        exit = {1, 0};
+    } else {
+        return false;
+    }
+    return true;
+} /* }}} */
+
+} // namespace
+
+/* void SdlPong::Simulation::SweepBall {{{
+ * Swept AABB: find the earliest body the ball reaches on its way from its
+ * start position, stop it there, apply the same response as
+ * RegisterCollision and carry on with the rest of the tick. Bars are swept
+ * with their own velocity subtracted so moving bars are hit correctly.
+ * Bodies the ball already overlaps at the start are left to
+ * CheckCollisions.
+ * */
+void SdlPong::Simulation::SweepBall(Entity ball, int startX, int startY) {
+    EntityStore &es{mEntities};
+
+    long long x{startX};
+    long long y{startY};
+    long long xvel{es.xvel[ball]};
+    long long yvel{es.yvel[ball]};
+    long long u{0}; // elapsed part of the tick, in kSweepSteps
+
+    for (int hits{0}; hits < kMaxSweepHits; ++hits) {
+        const long long remaining{kSweepSteps - u};
+
+        Entity target{-1};
+        Fraction first{};
+        bool normalX{false};
+
+        for (Entity o{0}; o < es.size(); ++o) {
+            SdlPong::Response response{
+                SdlPong::CollisionResponse(es.id[ball], es.id[o])};
+            if (o == ball || response == SdlPong::noResponse)
+                continue;
+
+            // Where the other body is at time u and how far the ball moves
+            // relative to it during the rest of the tick
+            long long ox{es.x[o] - es.xvel[o] +
+                         es.xvel[o] * u / kSweepSteps};
+            long long oy{es.y[o] - es.yvel[o] +
+                         es.yvel[o] * u / kSweepSteps};
+            long long dx{(xvel - es.xvel[o]) * remaining / kSweepSteps};
+            long long dy{(yvel - es.yvel[o]) * remaining / kSweepSteps};
+
+            Fraction entryX, exitX, entryY, exitY;
+            if (!AxisTimes(x, es.w[ball], dx, ox, es.w[o], entryX, exitX) ||
+                !AxisTimes(y, es.h[ball], dy, oy, es.h[o], entryY, exitY))
+                continue;
+
+            bool alongX{!Less(entryX, entryY)};
+            Fraction entry{alongX ? entryX : entryY};
+            Fraction exit{Less(exitX, exitY) ? exitX : exitY};
+
+            // Already overlapping, or not reached within this tick
+            if (entry.den == 0 || entry.num < 0 || entry.num >= entry.den ||
+                !Less(entry, exit))
+                continue;
+
+            if (target < 0 || Less(entry, first)) {
+                target = o;
+                first = entry;
+                normalX = alongX;
+            }
+        }
+
+        if (target < 0)
+            break;
+
+        // Move to the point of contact, flush against the other body
+        long long hitU{u + first.num * remaining / first.den};
+        x += xvel * hitU / kSweepSteps - xvel * u / kSweepSteps;
+        y += yvel * hitU / kSweepSteps - yvel * u / kSweepSteps;
+        long long ox{es.x[target] - es.xvel[target] +
+                     es.xvel[target] * hitU / kSweepSteps};
+        long long oy{es.y[target] - es.yvel[target] +
+                     es.yvel[target] * hitU / kSweepSteps};
+        if (normalX)
+            x = xvel > es.xvel[target] ? ox - es.w[ball] : ox + es.w[target];
+        else
+            y = yvel > es.yvel[target] ? oy - es.h[ball] : oy + es.h[target];
+        u = hitU;
+
+        es.x[ball] = static_cast<int>(x);
+        es.y[ball] = static_cast<int>(y);
+        es.xvel[ball] = static_cast<int>(xvel);
+        es.yvel[ball] = static_cast<int>(yvel);
+
+        if (SdlPong::CollisionResponse(es.id[ball], es.id[target]) ==
+            SdlPong::scoreResponse) {
+            // The ball is served again, nothing left to sweep
+            ScorePoint(ball, es.id[target]);
+            return;
+        }
+
+        AddImpact(SdlPong::bounceImpact, ball, es.id[target]);
+        es.RegisterCollision(ball, target);
+        es.collided[ball] = false;
+        xvel = es.postXvel[ball];
+        yvel = es.postYvel[ball];
+    }
+
+    // Rest of the tick
+    x += xvel - xvel * u / kSweepSteps;
+    y += yvel - yvel * u / kSweepSteps;
+
+    es.x[ball] = static_cast<int>(x);
+    es.y[ball] = static_cast<int>(y);
+    es.xvel[ball] = static_cast<int>(xvel);
+    es.yvel[ball] = static_cast<int>(yvel);
+} /* }}} */
+
+/* void SdlPong::Simulation::ScorePoint(Entity ball, SdlPong::Id wall) {{{
+ * The ball reached a side wall: the other player scores and the ball is
+ * served towards the player who lost the point.
+ * */
+void SdlPong::Simulation::ScorePoint(Entity ball, SdlPong::Id wall) {
+    AddImpact(SdlPong::scoreImpact, ball, wall);
+    mEntities.reset(ball);
+    if (wall == SdlPong::leftWall) {
+        incScore(SdlPong::right);
+        mEntities.setVel(ball, {.xvel = -barVel, .yvel = 0});
+    } else {
+        incScore(SdlPong::left);
+        mEntities.setVel(ball, {.xvel = barVel, .yvel = 0});
+    }
+} /* }}} */
+
+/* void SdlPong::Simulation::CheckCollisions() {{{ */
+void SdlPong::Simulation::CheckCollisions() {
+
+    // Collisions to check:
+    // ball against bars
+    // ball against walls
+    // bars against top and bottom wall
+
+    const std::vector<CollisionPair> &pairs{mBroadPhase.FindPairs(mEntities)};
+
+    // Bodies that were moved back to their start this tick; pairs found
+    // before the move may no longer touch
+    mServed.assign(mEntities.size(), false);
+
+    for (const CollisionPair &pair : pairs) {
+        if (mServed[pair.a] || mServed[pair.b]) {
+            SdlPong::Rect a{mEntities.rect(pair.a)};
+            SdlPong::Rect b{mEntities.rect(pair.b)};
+            if (!SdlPong::HasIntersection(&a, &b))
+                continue;
+        }
+
+        for (auto [self, other] : {std::pair{pair.a, pair.b},
+                                   std::pair{pair.b, pair.a}}) {
+            SdlPong::Id selfId{mEntities.id[self]};
+            SdlPong::Id otherId{mEntities.id[other]};
+            SdlPong::Response response{
+                SdlPong::CollisionResponse(selfId, otherId)};
+
+            if (response == SdlPong::scoreResponse) {
+                // Simulation handles this case
+                ScorePoint(self, otherId);
+                mServed[self] = true;
+            } else if (response != SdlPong::noResponse) {
+                if (selfId == SdlPong::ball)
+                    AddImpact(SdlPong::bounceImpact, self, otherId);
+                mEntities.RegisterCollision(self, other);
+            }
+        }
+    }
+
+} /* }}} */
+
+/* void SdlPong::Simulation::ProcessCollisions() {{{ */
+void SdlPong::Simulation::ProcessCollisions() {
+
+    mEntities.HandleCollisions();
+
+} /* }}} */
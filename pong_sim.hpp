@@ -0,0 +1,139 @@
+#ifndef _JC_PONG_SIM
+#define _JC_PONG_SIM
+
+#include "collision.hpp"
+#include "entity_store.hpp"
+#include "fixed_point.hpp"
+#include "profiler.hpp"
+#include <cstdint>
+#include <vector>
+
+// Game rules only. Nothing in here may depend on SDL video, rendering or
+// fonts so that matches can be simulated headless.
+
+namespace SdlPong {
+
+// Player input for one tick
+struct Inputs {
+    BarDirection left{none};
+    BarDirection right{none};
+};
+
+// Everything about a match that changes while it is played, with bodies
+// indexed by Id. Plain data, so it can be copied, compared and written out
+// field by field.
+struct SimState {
+    std::int32_t ai;
+    std::int32_t continuous;
+    std::int32_t leftScore;
+    std::int32_t rightScore;
+
+    std::int32_t x[kNumIds];
+    std::int32_t y[kNumIds];
+    std::int32_t xvel[kNumIds];
+    std::int32_t yvel[kNumIds];
+
+    bool operator==(const SimState &other) const = default;
+};
+
+enum ImpactKind { bounceImpact, scoreImpact };
+
+// The ball hitting something, for effects and sounds in the front end
+struct Impact {
+    ImpactKind kind;
+    Id other; // what the ball hit; a side wall when a point was scored
+    Fixed x;  // middle of the ball at the moment of contact
+    Fixed y;
+};
+
+class Simulation {
+
+  public:
+    // The field is the same for every window size; see fixed_point.hpp
+    explicit Simulation(int tickRate = kBaseTickRate);
+
+    void startGame(bool ai);
+
+    void incScore(Side side);
+    void decScore(Side side);
+    void moveBar(Side side, BarDirection dir);
+
+    // Advance the game by one tick
+    void step(const Inputs &inputs);
+
+    void UpdatePositions();
+    void CheckCollisions();
+    void ProcessCollisions();
+
+    // Move balls along their path within a tick and bounce them at the
+    // exact point of contact, so fast balls cannot pass through bars or
+    // walls. Off by default, which keeps the rules of BatchEnv.
+    void setContinuousCollisions(bool enabled);
+
+    // Snapshot of the match between ticks. Restoring it into a Simulation
+    // built with the same tick rate continues the match exactly as the
+    // original would.
+    SimState saveState() const;
+    void loadState(const SimState &state);
+
+    // Everything the ball hit during the last step()
+    const std::vector<Impact> &getImpacts() const;
+
+    // Time the phases of step() into profiler; null turns it off
+    void setProfiler(Profiler *profiler);
+
+    int getScore(Side side) const;
+    bool isAI() const;
+    int getTickRate() const;
+    int getBarVel() const;
+    GraphicBox getGraphicBox(Id id) const;
+    RigidBody getVel(Id id) const;
+
+  private:
+    // Thickness of the invisible walls, in whole world units
+    static constexpr int kPadding{10};
+
+    // Resolution of contact times within a tick
+    static constexpr long long kSweepSteps{1 << 16};
+    // Bounces resolved per ball per tick; any remaining time is moved
+    // without further checks
+    static constexpr int kMaxSweepHits{4};
+
+    void ScorePoint(Entity ball, Id wall);
+    void AddImpact(ImpactKind kind, Entity ball, Id other);
+    void SweepBall(Entity ball, int startX, int startY);
+
+    bool mAI;
+    bool mContinuous{false};
+    Profiler *mProfiler{nullptr};
+
+    int mTickRate;
+    Fixed barVel; // per tick
+
+    int mLeftScore;
+    int mRightScore;
+
+    EntityStore mEntities;
+    BroadPhase mBroadPhase;
+    std::vector<std::uint8_t> mServed;
+    std::vector<int> mSweepStartX;
+    std::vector<int> mSweepStartY;
+    std::vector<Impact> mImpacts;
+
+    Entity mBall;
+    Entity mLeftBar;
+    Entity mRightBar;
+
+    // invisible bodies
+    Entity mTopWall;
+    Entity mBottomWall;
+    Entity mLeftWall;
+    Entity mRightWall;
+
+    // For interating through
+    Entity mBodies[kNumIds]; // indexed by Id
+};
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_PONG_SIM */
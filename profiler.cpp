@@ -0,0 +1,153 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// Small per-thread number for trace output
+std::uint32_t ThreadIndex() {
+    static std::atomic<std::uint32_t> next{0};
+    thread_local std::uint32_t index{next.fetch_add(1)};
+    return index;
+}
+
+} // namespace
+
+const char *SdlPong::ProfilePhaseName(SdlPong::ProfilePhase phase) {
+    static constexpr const char *names[kNumProfilePhases]{
+        "frame",  "UpdatePositions", "CheckCollisions", "ProcessCollisions",
+        "Render", "RenderPresent",   "setText"};
+    return names[phase];
+}
+
+SdlPong::Profiler::Profiler() : mEpochNS{0} { mEpochNS = now(); }
+
+std::uint64_t SdlPong::Profiler::now() const {
+    return static_cast<std::uint64_t>(
+               std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+                   .count()) -
+           mEpochNS;
+}
+
+void SdlPong::Profiler::beginFrame() {
+    mFrame.fetch_add(1, std::memory_order_relaxed);
+}
+
+/* void SdlPong::Profiler::record {{{ */
+void SdlPong::Profiler::record(SdlPong::ProfilePhase phase,
+                               std::uint64_t startNS, std::uint64_t endNS) {
+    const std::uint64_t index{mHead.fetch_add(1, std::memory_order_relaxed)};
+    Slot &slot{mSlots[index % kCapacity]};
+
+    // Mark the slot as being written, fill it, then publish
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.meta.store(
+        static_cast<std::uint64_t>(phase) |
+            static_cast<std::uint64_t>(ThreadIndex() & 0xFFFFFF) << 8 |
+            static_cast<std::uint64_t>(
+                mFrame.load(std::memory_order_relaxed))
+                << 32,
+        std::memory_order_relaxed);
+    slot.startNS.store(startNS, std::memory_order_relaxed);
+    slot.durationNS.store(endNS - startNS, std::memory_order_relaxed);
+    slot.seq.store(index + 1, std::memory_order_release);
+} /* }}} */
+
+/* template <typename F> void SdlPong::Profiler::ForEachEvent {{{ */
+template <typename F>
+void SdlPong::Profiler::ForEachEvent(F &&visit) const {
+    const std::uint64_t head{mHead.load(std::memory_order_acquire)};
+    const std::uint64_t first{head > kCapacity ? head - kCapacity : 0};
+
+    for (std::uint64_t index{first}; index < head; ++index) {
+        const Slot &slot{mSlots[index % kCapacity]};
+        if (slot.seq.load(std::memory_order_acquire) != index + 1)
+            continue;
+        std::uint64_t meta{slot.meta.load(std::memory_order_relaxed)};
+        Event event{.phase = static_cast<ProfilePhase>(meta & 0xFF),
+                    .frame = static_cast<std::uint32_t>(meta >> 32),
+                    .thread = static_cast<std::uint32_t>(meta >> 8 & 0xFFFFFF),
+                    .startNS = slot.startNS.load(std::memory_order_relaxed),
+                    .durationNS =
+                        slot.durationNS.load(std::memory_order_relaxed)};
+        // Overwritten while reading
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != index + 1)
+            continue;
+        visit(event);
+    }
+} /* }}} */
+
+/* void SdlPong::Profiler::Summarize {{{ */
+void SdlPong::Profiler::Summarize(
+    SdlPong::PhaseStats stats[kNumProfilePhases]) const {
+    std::vector<std::uint64_t> durations[kNumProfilePhases];
+    ForEachEvent([&durations](const Event &event) {
+        durations[event.phase].push_back(event.durationNS);
+    });
+
+    for (int phase{0}; phase < kNumProfilePhases; ++phase) {
+        std::vector<std::uint64_t> &d{durations[phase]};
+        stats[phase] = {.count = static_cast<int>(d.size()),
+                        .p50Ms = 0,
+                        .p99Ms = 0,
+                        .maxMs = 0};
+        if (d.empty())
+            continue;
+
+        auto percentile = [&d](double p) {
+            auto nth{d.begin() + static_cast<std::ptrdiff_t>(
+                                     p * static_cast<double>(d.size() - 1))};
+            std::nth_element(d.begin(), nth, d.end());
+            return *nth / 1e6;
+        };
+        stats[phase].p50Ms = percentile(0.50);
+        stats[phase].p99Ms = percentile(0.99);
+        stats[phase].maxMs = *std::max_element(d.begin(), d.end()) / 1e6;
+    }
+} /* }}} */
+
+/* void SdlPong::Profiler::report(std::ostream &out) const {{{ */
+void SdlPong::Profiler::report(std::ostream &out) const {
+    PhaseStats stats[kNumProfilePhases];
+    Summarize(stats);
+
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-18s %7s %9s %9s %9s\n", "phase",
+                  "count", "p50 ms", "p99 ms", "max ms");
+    out << line;
+    for (int phase{0}; phase < kNumProfilePhases; ++phase) {
+        const PhaseStats &s{stats[phase]};
+        std::snprintf(line, sizeof(line), "%-18s %7d %9.3f %9.3f %9.3f\n",
+                      ProfilePhaseName(static_cast<ProfilePhase>(phase)),
+                      s.count, s.p50Ms, s.p99Ms, s.maxMs);
+        out << line;
+    }
+} /* }}} */
+
+/* bool SdlPong::Profiler::WriteChromeTrace {{{ */
+bool SdlPong::Profiler::WriteChromeTrace(const std::string &path) const {
+    std::FILE *file{std::fopen(path.c_str(), "w")};
+    if (file == nullptr)
+        return false;
+
+    // Complete ("X") events, timestamps in microseconds
+    std::fputs("{\"traceEvents\":[\n", file);
+    bool first{true};
+    ForEachEvent([file, &first](const Event &event) {
+        std::fprintf(file,
+                     "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                     "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+                     first ? "" : ",\n", ProfilePhaseName(event.phase),
+                     event.thread, event.startNS / 1e3,
+                     event.durationNS / 1e3, event.frame);
+        first = false;
+    });
+    std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+
+    return std::fclose(file) == 0;
+} /* }}} */
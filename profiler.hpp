@@ -0,0 +1,108 @@
+#ifndef _JC_PROFILER
+#define _JC_PROFILER
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace SdlPong {
+
+enum ProfilePhase {
+    framePhase, // one whole SDL_AppIterate
+    updatePositionsPhase,
+    checkCollisionsPhase,
+    processCollisionsPhase,
+    renderPhase,
+    presentPhase,
+    setTextPhase,
+};
+
+constexpr int kNumProfilePhases{setTextPhase + 1};
+
+const char *ProfilePhaseName(ProfilePhase phase);
+
+// Timings of one phase over the events still in the ring
+struct PhaseStats {
+    int count;
+    double p50Ms;
+    double p99Ms;
+    double maxMs;
+};
+
+/* class Profiler {{{
+ * Records how long each phase takes into a fixed ring of the most recent
+ * kCapacity events. Recording is lock-free and safe from any thread; the
+ * readers skip events that are overwritten while they look at them.
+ * */
+class Profiler {
+  public:
+    static constexpr int kCapacity{1 << 14};
+
+    Profiler();
+
+    // Current time on the profiler's clock
+    std::uint64_t now() const;
+
+    void beginFrame();
+    void record(ProfilePhase phase, std::uint64_t startNS,
+                std::uint64_t endNS);
+
+    void Summarize(PhaseStats stats[kNumProfilePhases]) const;
+    void report(std::ostream &out) const;
+    // Chrome trace-event JSON, for chrome://tracing or Perfetto
+    bool WriteChromeTrace(const std::string &path) const;
+
+  private:
+    struct Event {
+        ProfilePhase phase;
+        std::uint32_t frame;
+        std::uint32_t thread;
+        std::uint64_t startNS;
+        std::uint64_t durationNS;
+    };
+
+    // Each field is atomic so that a reader racing a writer sees a torn
+    // event rather than undefined behaviour; seq tells them apart
+    struct Slot {
+        std::atomic<std::uint64_t> seq{0}; // event index + 1 once written
+        std::atomic<std::uint64_t> meta{0}; // phase | thread << 8 | frame << 32
+        std::atomic<std::uint64_t> startNS{0};
+        std::atomic<std::uint64_t> durationNS{0};
+    };
+
+    // Visit the events in the ring, oldest first
+    template <typename F> void ForEachEvent(F &&visit) const;
+
+    std::uint64_t mEpochNS;
+    std::atomic<std::uint64_t> mHead{0};
+    std::atomic<std::uint32_t> mFrame{0};
+    Slot mSlots[kCapacity];
+}; /* }}} */
+
+/* class ProfileScope {{{
+ * Records the phase from construction to destruction. Does nothing when
+ * profiler is null.
+ * */
+class ProfileScope {
+  public:
+    ProfileScope(Profiler *profiler, ProfilePhase phase)
+        : mProfiler{profiler}, mPhase{phase},
+          mStartNS{profiler ? profiler->now() : 0} {}
+    ~ProfileScope() {
+        if (mProfiler)
+            mProfiler->record(mPhase, mStartNS, mProfiler->now());
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+  private:
+    Profiler *mProfiler;
+    ProfilePhase mPhase;
+    std::uint64_t mStartNS;
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_PROFILER */
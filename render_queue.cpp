@@ -0,0 +1,127 @@
+#include "render_queue.hpp"
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+
+void SdlPong::RenderQueue::AddRect(const SDL_FRect &rect, SDL_FColor color,
+                                   RenderLayer layer) {
+    AddQuad(nullptr, rect, {0, 0, 0, 0}, color, layer);
+}
+
+/* void SdlPong::RenderQueue::AddQuad {{{ */
+void SdlPong::RenderQueue::AddQuad(SDL_Texture *texture, const SDL_FRect &dst,
+                                   const SDL_FRect &uv, SDL_FColor color,
+                                   RenderLayer layer) {
+    const float x1{dst.x + dst.w};
+    const float y1{dst.y + dst.h};
+    const float u1{uv.x + uv.w};
+    const float v1{uv.y + uv.h};
+    mQuads.push_back({.layer = layer,
+                      .texture = texture,
+                      .corners = {{{dst.x, dst.y}, color, {uv.x, uv.y}},
+                                  {{x1, dst.y}, color, {u1, uv.y}},
+                                  {{x1, y1}, color, {u1, v1}},
+                                  {{dst.x, y1}, color, {uv.x, v1}}}});
+} /* }}} */
+
+void SdlPong::RenderQueue::AddText(GlyphAtlas &atlas, SDL_Texture *texture,
+                                   std::string_view text, float x, float y,
+                                   SDL_FColor color, RenderLayer layer) {
+    mGlyphs.clear();
+    atlas.LayoutText(text, x, y, mGlyphs);
+    for (const GlyphQuad &glyph : mGlyphs)
+        AddQuad(texture, glyph.dst, glyph.uv, color, layer);
+}
+
+void SdlPong::RenderQueue::AddQuadBatch(const SDL_Vertex *corners,
+                                        int numQuads, RenderLayer layer) {
+    if (numQuads > 0)
+        mBatches.push_back(
+            {.layer = layer, .corners = corners, .numQuads = numQuads});
+}
+
+/* void SdlPong::RenderQueue::SubmitBatches {{{
+ * Draw the batches of every layer below the given one
+ * */
+void SdlPong::RenderQueue::SubmitBatches(SDL_Renderer *renderer,
+                                         int below) {
+    for (; mNextBatch < mBatches.size() &&
+           mBatches[mNextBatch].layer < below;
+         ++mNextBatch) {
+        const QuadBatch &batch{mBatches[mNextBatch]};
+
+        // The index pattern is the same for every batch, so it is only
+        // ever extended
+        const int numIndices{batch.numQuads * 6};
+        for (int base{static_cast<int>(mBatchIndices.size()) / 6 * 4};
+             static_cast<int>(mBatchIndices.size()) < numIndices; base += 4) {
+            for (int corner : {0, 1, 2, 0, 2, 3})
+                mBatchIndices.push_back(base + corner);
+        }
+
+        SDL_RenderGeometry(renderer, nullptr, batch.corners,
+                           batch.numQuads * 4, mBatchIndices.data(),
+                           numIndices);
+        ++mDrawCalls;
+    }
+} /* }}} */
+
+/* void SdlPong::RenderQueue::Submit(SDL_Renderer *renderer) {{{ */
+void SdlPong::RenderQueue::Submit(SDL_Renderer *renderer) {
+    mDrawCalls = 0;
+
+    // Stable, so quads within a batch keep the order they were added in
+    mOrder.resize(mQuads.size());
+    for (int i{0}; i < static_cast<int>(mOrder.size()); ++i)
+        mOrder[i] = i;
+    std::stable_sort(mOrder.begin(), mOrder.end(), [this](int a, int b) {
+        if (mQuads[a].layer != mQuads[b].layer)
+            return mQuads[a].layer < mQuads[b].layer;
+        return std::less<SDL_Texture *>{}(mQuads[a].texture,
+                                          mQuads[b].texture);
+    });
+    std::stable_sort(mBatches.begin(), mBatches.end(),
+                     [](const QuadBatch &a, const QuadBatch &b) {
+                         return a.layer < b.layer;
+                     });
+    mNextBatch = 0;
+
+    // Untextured geometry blends with the draw blend mode
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    std::size_t i{0};
+    while (i < mOrder.size()) {
+        const Quad &first{mQuads[mOrder[i]]};
+        SubmitBatches(renderer, first.layer);
+        mVertices.clear();
+        mIndices.clear();
+
+        for (; i < mOrder.size(); ++i) {
+            const Quad &quad{mQuads[mOrder[i]]};
+            if (quad.layer != first.layer || quad.texture != first.texture)
+                break;
+            const int base{static_cast<int>(mVertices.size())};
+            mVertices.insert(mVertices.end(), std::begin(quad.corners),
+                             std::end(quad.corners));
+            for (int corner : {0, 1, 2, 0, 2, 3})
+                mIndices.push_back(base + corner);
+        }
+
+        SDL_RenderGeometry(renderer, first.texture, mVertices.data(),
+                           static_cast<int>(mVertices.size()), mIndices.data(),
+                           static_cast<int>(mIndices.size()));
+        ++mDrawCalls;
+    }
+    SubmitBatches(renderer, kNumRenderLayers);
+
+    mQuads.clear();
+    mBatches.clear();
+} /* }}} */
+
+void SdlPong::RenderQueue::clear() {
+    mQuads.clear();
+    mBatches.clear();
+}
+
+int SdlPong::RenderQueue::getDrawCalls() const { return mDrawCalls; }
@@ -0,0 +1,80 @@
+#ifndef _JC_RENDER_QUEUE
+#define _JC_RENDER_QUEUE
+
+#include "glyph_atlas.hpp"
+#include <SDL3/SDL.h>
+#include <string_view>
+#include <vector>
+
+namespace SdlPong {
+
+// Draw order; everything on a lower layer is drawn first
+enum RenderLayer {
+    gameLayer,
+    hudLayer,
+};
+
+constexpr int kNumRenderLayers{hudLayer + 1};
+
+/* class RenderQueue {{{
+ * Collects every rectangle and textured quad of a frame, sorts them by layer
+ * and texture, and submits each run that shares both with a single
+ * SDL_RenderGeometry call. Colors are per vertex, so they never split a
+ * batch. The number of draw calls does not grow with the number of bodies.
+ * */
+class RenderQueue {
+  public:
+    void AddRect(const SDL_FRect &rect, SDL_FColor color,
+                 RenderLayer layer = gameLayer);
+    void AddQuad(SDL_Texture *texture, const SDL_FRect &dst,
+                 const SDL_FRect &uv, SDL_FColor color,
+                 RenderLayer layer = gameLayer);
+    void AddText(GlyphAtlas &atlas, SDL_Texture *texture,
+                 std::string_view text, float x, float y, SDL_FColor color,
+                 RenderLayer layer = hudLayer);
+    // Untextured quads whose corners, four per quad in drawing order, the
+    // caller has already built. They are drawn with one call after the
+    // other quads of their layer and must stay valid until Submit.
+    void AddQuadBatch(const SDL_Vertex *corners, int numQuads,
+                      RenderLayer layer = gameLayer);
+
+    // Draw everything queued since the last Submit and empty the queue
+    void Submit(SDL_Renderer *renderer);
+    // Drop everything queued since the last Submit without drawing it
+    void clear();
+
+    // Draw calls issued by the last Submit
+    int getDrawCalls() const;
+
+  private:
+    struct Quad {
+        RenderLayer layer;
+        SDL_Texture *texture; // nullptr for plain rectangles
+        SDL_Vertex corners[4];
+    };
+
+    struct QuadBatch {
+        RenderLayer layer;
+        const SDL_Vertex *corners;
+        int numQuads;
+    };
+
+    void SubmitBatches(SDL_Renderer *renderer, int below);
+
+    std::vector<Quad> mQuads;
+    std::vector<int> mOrder;
+    std::vector<QuadBatch> mBatches;
+    std::size_t mNextBatch{0}; // during Submit
+
+    // Reused between frames
+    std::vector<GlyphQuad> mGlyphs;
+    std::vector<SDL_Vertex> mVertices;
+    std::vector<int> mIndices;
+    std::vector<int> mBatchIndices; // 0, 1, 2, 0, 2, 3 for every quad
+
+    int mDrawCalls{0};
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_RENDER_QUEUE */
@@ -0,0 +1,246 @@
+#include "replay.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[8] = {'P', 'O', 'N', 'G', 'R', 'P', 'L', '2'};
+
+constexpr std::uint8_t kStartBit{1 << 4};
+constexpr std::uint8_t kAIBit{1 << 5};
+
+// SimState field by field, in declaration order
+constexpr int kStateInts{4 + 4 * SdlPong::kNumIds};
+
+std::uint8_t EncodeTick(const SdlPong::Inputs &inputs) {
+    return static_cast<std::uint8_t>(inputs.left | inputs.right << 2);
+}
+
+// Both inputs are BarDirections and no unknown bits are set
+bool IsValidTick(std::uint8_t tick) {
+    return (tick & 3) <= SdlPong::none && (tick >> 2 & 3) <= SdlPong::none &&
+           (tick & ~(kStartBit | kAIBit | 15)) == 0;
+}
+
+void ToInts(const SdlPong::SimState &state, std::int32_t *out) {
+    *out++ = state.ai;
+    *out++ = state.continuous;
+    *out++ = state.leftScore;
+    *out++ = state.rightScore;
+    for (const std::int32_t *field :
+         {state.x, state.y, state.xvel, state.yvel}) {
+        std::memcpy(out, field, sizeof(std::int32_t) * SdlPong::kNumIds);
+        out += SdlPong::kNumIds;
+    }
+}
+
+void FromInts(const std::int32_t *in, SdlPong::SimState &state) {
+    state.ai = *in++;
+    state.continuous = *in++;
+    state.leftScore = *in++;
+    state.rightScore = *in++;
+    for (std::int32_t *field : {state.x, state.y, state.xvel, state.yvel}) {
+        std::memcpy(field, in, sizeof(std::int32_t) * SdlPong::kNumIds);
+        in += SdlPong::kNumIds;
+    }
+}
+
+bool WriteInts(std::FILE *file, const std::int32_t *values, int count) {
+    for (int i{0}; i < count; ++i) {
+        std::uint32_t v{static_cast<std::uint32_t>(values[i])};
+        unsigned char bytes[4]{static_cast<unsigned char>(v),
+                               static_cast<unsigned char>(v >> 8),
+                               static_cast<unsigned char>(v >> 16),
+                               static_cast<unsigned char>(v >> 24)};
+        if (std::fwrite(bytes, 1, 4, file) != 4)
+            return false;
+    }
+    return true;
+}
+
+bool ReadInts(std::FILE *file, std::int32_t *values, int count) {
+    for (int i{0}; i < count; ++i) {
+        unsigned char bytes[4];
+        if (std::fread(bytes, 1, 4, file) != 4)
+            return false;
+        values[i] = static_cast<std::int32_t>(
+            std::uint32_t{bytes[0]} | std::uint32_t{bytes[1]} << 8 |
+            std::uint32_t{bytes[2]} << 16 | std::uint32_t{bytes[3]} << 24);
+    }
+    return true;
+}
+
+// Bytes from the current position to the end of file, -1 if unknown
+long RemainingBytes(std::FILE *file) {
+    const long position{std::ftell(file)};
+    if (position < 0 || std::fseek(file, 0, SEEK_END) != 0)
+        return -1;
+    const long end{std::ftell(file)};
+    if (std::fseek(file, position, SEEK_SET) != 0)
+        return -1;
+    return end - position;
+}
+
+} // namespace
+
+int SdlPong::Replay::getNumTicks() const {
+    return static_cast<int>(ticks.size());
+}
+
+/* bool SdlPong::Replay::save(const std::string &path) const {{{ */
+bool SdlPong::Replay::save(const std::string &path) const {
+    std::FILE *file{std::fopen(path.c_str(), "wb")};
+    if (file == nullptr)
+        return false;
+
+    const std::int32_t header[]{tickRate,
+                                keyframeInterval,
+                                getNumTicks(),
+                                static_cast<std::int32_t>(keyframes.size())};
+    bool ok{std::fwrite(kMagic, 1, sizeof(kMagic), file) == sizeof(kMagic) &&
+            WriteInts(file, header, 4) &&
+            std::fwrite(ticks.data(), 1, ticks.size(), file) == ticks.size()};
+
+    std::int32_t ints[kStateInts];
+    for (std::size_t i{0}; ok && i < keyframes.size(); ++i) {
+        ToInts(keyframes[i], ints);
+        ok = WriteInts(file, ints, kStateInts);
+    }
+
+    return std::fclose(file) == 0 && ok;
+} /* }}} */
+
+/* bool SdlPong::Replay::load(const std::string &path) {{{ */
+bool SdlPong::Replay::load(const std::string &path) {
+    std::FILE *file{std::fopen(path.c_str(), "rb")};
+    if (file == nullptr)
+        return false;
+
+    char magic[sizeof(kMagic)];
+    std::int32_t header[4];
+    bool ok{std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+            std::memcmp(magic, kMagic, sizeof(kMagic)) == 0 &&
+            ReadInts(file, header, 4)};
+
+    // Keyframes must cover the ticks exactly as ReplayRecorder makes them
+    ok = ok && header[0] > 0 && header[1] > 0 && header[2] >= 0 &&
+         header[3] == header[2] / header[1] + 1;
+    // Check the file holds what the header claims before allocating for it
+    ok = ok && RemainingBytes(file) >=
+                   header[2] + std::int64_t{header[3]} * kStateInts * 4;
+
+    if (ok) {
+        tickRate = header[0];
+        keyframeInterval = header[1];
+        ticks.resize(header[2]);
+        keyframes.resize(header[3]);
+        ok = std::fread(ticks.data(), 1, ticks.size(), file) ==
+                 ticks.size() &&
+             std::all_of(ticks.begin(), ticks.end(), IsValidTick);
+    }
+
+    std::int32_t ints[kStateInts];
+    for (std::size_t i{0}; ok && i < keyframes.size(); ++i) {
+        ok = ReadInts(file, ints, kStateInts);
+        FromInts(ints, keyframes[i]);
+    }
+
+    std::fclose(file);
+    return ok;
+} /* }}} */
+
+/* SdlPong::ReplayRecorder::ReplayRecorder {{{ */
+SdlPong::ReplayRecorder::ReplayRecorder(const Simulation &sim,
+                                        int keyframeInterval) {
+    assert(keyframeInterval > 0 && "Keyframe interval must be positive");
+
+    mReplay.tickRate = sim.getTickRate();
+    mReplay.keyframeInterval = keyframeInterval;
+    mReplay.keyframes.push_back(sim.saveState());
+}
+/* }}} */
+
+void SdlPong::ReplayRecorder::startGame(bool ai) {
+    mPendingStart = kStartBit | (ai ? kAIBit : 0);
+}
+
+/* void SdlPong::ReplayRecorder::step {{{ */
+void SdlPong::ReplayRecorder::step(const Simulation &sim,
+                                   const Inputs &inputs) {
+    mReplay.ticks.push_back(EncodeTick(inputs) | mPendingStart);
+    mPendingStart = 0;
+
+    // A keyframe is taken between ticks, before any startGame of the next
+    // tick is known, so it is the state the next tick byte applies to
+    if (mReplay.getNumTicks() % mReplay.keyframeInterval == 0)
+        mReplay.keyframes.push_back(sim.saveState());
+} /* }}} */
+
+const SdlPong::Replay &SdlPong::ReplayRecorder::getReplay() const {
+    return mReplay;
+}
+
+SdlPong::ReplayPlayer::ReplayPlayer(const Replay &replay, Simulation &sim)
+    : mReplay{replay}, mSim{sim} {
+    mSim.loadState(mReplay.keyframes[0]);
+}
+
+/* void SdlPong::ReplayPlayer::seek(int tick) {{{ */
+void SdlPong::ReplayPlayer::seek(int tick) {
+    if (tick < 0)
+        tick = 0;
+    if (tick > mReplay.getNumTicks())
+        tick = mReplay.getNumTicks();
+
+    // Only restore when going back or past the next keyframe; otherwise
+    // stepping forward from here is cheaper
+    int keyframe{tick / mReplay.keyframeInterval};
+    if (tick < mTick || keyframe * mReplay.keyframeInterval > mTick) {
+        mSim.loadState(mReplay.keyframes[keyframe]);
+        mTick = keyframe * mReplay.keyframeInterval;
+    }
+
+    while (mTick < tick)
+        step();
+} /* }}} */
+
+/* bool SdlPong::ReplayPlayer::step() {{{ */
+bool SdlPong::ReplayPlayer::step() {
+    if (isFinished())
+        return false;
+
+    const std::uint8_t tick{mReplay.ticks[mTick]};
+    if (tick & kStartBit)
+        mSim.startGame((tick & kAIBit) != 0);
+
+    Inputs inputs{.left = static_cast<BarDirection>(tick & 3),
+                  .right = static_cast<BarDirection>(tick >> 2 & 3)};
+    mSim.step(inputs);
+    ++mTick;
+    return true;
+} /* }}} */
+
+/* int SdlPong::ReplayPlayer::verify() {{{ */
+int SdlPong::ReplayPlayer::verify() {
+    mSim.loadState(mReplay.keyframes[0]);
+    mTick = 0;
+    while (step()) {
+        if (mTick % mReplay.keyframeInterval == 0 &&
+            mSim.saveState() !=
+                mReplay.keyframes[mTick / mReplay.keyframeInterval])
+            return mTick;
+    }
+    return -1;
+} /* }}} */
+
+int SdlPong::ReplayPlayer::getTick() const { return mTick; }
+
+bool SdlPong::ReplayPlayer::isFinished() const {
+    return mTick >= mReplay.getNumTicks();
+}
+
+const SdlPong::Replay &SdlPong::ReplayPlayer::getReplay() const {
+    return mReplay;
+}
@@ -0,0 +1,91 @@
+#ifndef _JC_REPLAY
+#define _JC_REPLAY
+
+#include "pong_sim.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Recording and playback of matches. The rules are integer math only, so a
+// match is fully described by its start state and the inputs of every tick;
+// keyframes only make seeking fast.
+
+namespace SdlPong {
+
+/* struct Replay {{{
+ * A recorded match. Each tick is one byte:
+ *   bits 0-1  left BarDirection
+ *   bits 2-3  right BarDirection
+ *   bit 4     startGame was called before the tick
+ *   bit 5     its ai argument
+ * */
+struct Replay {
+    static constexpr int kDefaultKeyframeInterval{600};
+
+    // Simulation constructor argument
+    int tickRate{kBaseTickRate};
+
+    int keyframeInterval{kDefaultKeyframeInterval};
+    std::vector<std::uint8_t> ticks;
+    // keyframes[i] is the state before tick i * keyframeInterval
+    std::vector<SimState> keyframes;
+
+    int getNumTicks() const;
+
+    // Binary file, integers stored little endian. Return false on I/O
+    // errors or, for load, a file that is not a replay.
+    bool save(const std::string &path) const;
+    bool load(const std::string &path);
+}; /* }}} */
+
+// Builds a Replay alongside a live match
+class ReplayRecorder {
+  public:
+    // Starts recording from sim's current state
+    explicit ReplayRecorder(
+        const Simulation &sim,
+        int keyframeInterval = Replay::kDefaultKeyframeInterval);
+
+    // Call whenever Simulation::startGame is called
+    void startGame(bool ai);
+    // Call after every Simulation::step with the inputs it was given
+    void step(const Simulation &sim, const Inputs &inputs);
+
+    const Replay &getReplay() const;
+
+  private:
+    Replay mReplay;
+    std::uint8_t mPendingStart{0};
+};
+
+// Plays a Replay back into a Simulation built with the replay's tick rate.
+// Both must outlive the player.
+class ReplayPlayer {
+  public:
+    // Puts sim in the recorded start state
+    ReplayPlayer(const Replay &replay, Simulation &sim);
+
+    // Put the simulation in the state before tick, restoring the closest
+    // keyframe and stepping from there. tick is clamped to the recording.
+    void seek(int tick);
+    // Play the next recorded tick. Returns false at the end of the
+    // recording.
+    bool step();
+
+    // Play the whole recording from the start and compare each keyframe
+    // with the state reached. Returns the first tick that differs, or -1.
+    int verify();
+
+    int getTick() const;
+    bool isFinished() const;
+    const Replay &getReplay() const;
+
+  private:
+    const Replay &mReplay;
+    Simulation &mSim;
+    int mTick{0};
+};
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_REPLAY */
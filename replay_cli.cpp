@@ -0,0 +1,93 @@
+#include "replay.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Inspect a recorded match: print the state at any tick and check that the
+// recording still plays back bit for bit
+
+namespace {
+
+void PrintState(const SdlPong::Simulation &sim, int tick) {
+    std::printf("tick %d  score %d:%d%s\n", tick,
+                sim.getScore(SdlPong::left), sim.getScore(SdlPong::right),
+                sim.isAI() ? "  (AI)" : "");
+
+    const struct {
+        const char *name;
+        SdlPong::Id id;
+    } bodies[]{{"ball", SdlPong::ball},
+               {"left bar", SdlPong::leftBar},
+               {"right bar", SdlPong::rightBar}};
+    for (const auto &body : bodies) {
+        SdlPong::Rect r{sim.getGraphicBox(body.id).rect};
+        SdlPong::RigidBody rb{sim.getVel(body.id)};
+        std::printf("  %-9s  x %8d  y %8d  xvel %6d  yvel %6d\n", body.name,
+                    r.x, r.y, rb.xvel, rb.yvel);
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s REPLAY [--tick N] [--verify]\n",
+                     argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int tick{-1};
+    bool verify{false};
+    for (int i{2}; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--tick") == 0 && i + 1 < argc)
+            tick = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--verify") == 0)
+            verify = true;
+        else {
+            std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    SdlPong::Replay replay;
+    if (!replay.load(argv[1])) {
+        std::fprintf(stderr, "Could not read replay %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    std::printf("%d ticks/s, %d ticks (%.1f s), keyframe every %d\n",
+                replay.tickRate, replay.getNumTicks(),
+                static_cast<double>(replay.getNumTicks()) / replay.tickRate,
+                replay.keyframeInterval);
+
+    SdlPong::Simulation sim{replay.tickRate};
+    SdlPong::ReplayPlayer player{replay, sim};
+
+    using Clock = std::chrono::steady_clock;
+
+    if (verify) {
+        auto start{Clock::now()};
+        int bad{player.verify()};
+        double seconds{std::chrono::duration<double>(Clock::now() - start)
+                           .count()};
+        if (bad >= 0) {
+            std::printf("Replay diverges from its keyframe at tick %d\n", bad);
+            return EXIT_FAILURE;
+        }
+        std::printf("Verified %d ticks in %.3f s (%.0f ticks/s)\n",
+                    replay.getNumTicks(), seconds,
+                    replay.getNumTicks() / (seconds > 0 ? seconds : 1e-9));
+    }
+
+    if (tick >= 0) {
+        auto start{Clock::now()};
+        player.seek(tick);
+        double ms{std::chrono::duration<double, std::milli>(Clock::now() -
+                                                             start)
+                      .count()};
+        std::printf("Seek took %.3f ms\n", ms);
+        PrintState(sim, player.getTick());
+    }
+
+    return EXIT_SUCCESS;
+}
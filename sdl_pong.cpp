@@ -3,438 +3,790 @@
 #include "SDL3/SDL_pixels.h"
 #include "SDL3/SDL_rect.h"
 #include "SDL3/SDL_render.h"
+#include <algorithm>
 #include <cassert>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <sstream>
 #include <string>
 
-SdlPong::Body::Body(GraphicBox gb, RigidBody rb, SdlPong::Id id)
-    : mGraphicBox{gb}, mRigidBody{rb}, mId{id}, mInitGraphicBox{gb},
-      mInitRigidBody{rb}, mCollided{false} {}
+SdlPong::TextBody::TextBody(GlyphAtlas *atlas, GraphicBox gb)
+    : mAtlas{atlas}, mGraphicBox{gb} {}
 
-void SdlPong::Body::UpdatePos() {
+SDL_FColor SdlPong::ToFColor(Color color) {
+    return {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f,
+            color.a / 255.0f};
+}
 
-    mGraphicBox.rect.x += mRigidBody.xvel;
-    mGraphicBox.rect.y += mRigidBody.yvel;
+void SdlPong::TextBody::Render(SDL_Renderer *renderer, RenderQueue &queue) {
+    queue.AddText(*mAtlas, mAtlas->getTexture(renderer),
+                  {mText, static_cast<std::size_t>(mLength)},
+                  static_cast<float>(mGraphicBox.rect.x),
+                  static_cast<float>(mGraphicBox.rect.y),
+                  ToFColor(mGraphicBox.color));
 }
 
-void SdlPong::Body::Reset() {
-    mGraphicBox = mInitGraphicBox;
-    mRigidBody = mInitRigidBody;
+void SdlPong::TextBody::setText(std::string_view text) {
+    mLength = static_cast<int>(text.copy(mText, kMaxTextLength));
+    mGraphicBox.rect.w = mAtlas->measureWidth(text.substr(0, mLength));
+    mGraphicBox.rect.h = mAtlas->getHeight();
 }
 
-SDL_Rect *SdlPong::Body::GetCollisionBox() { return &mGraphicBox.rect; }
+/* SdlPong::AppState::AppState {{{ */
+SdlPong::AppState::AppState(int screenWidth, int screenHeight, int tickRate)
+    : mScreenWidth{screenWidth}, mScreenHeight{screenHeight},
+      mScaleX{static_cast<float>(screenWidth) / ToFixed(kWorldWidth)},
+      mScaleY{static_cast<float>(screenHeight) / ToFixed(kWorldHeight)},
+      mSim{tickRate},
+      mTickNS{SDL_NS_PER_SECOND / tickRate},
+      mLerpLimit{ToFixed(kWorldWidth / 4)}, mShownSim{tickRate},
+      mAtlas{mAssets.getAtlas(silkscreenFont, kFontSize)},
+      mLeftScoreShown{-1},
+      mRightScoreShown{-1} {
+    // SDL_AppInit will provide window and renderer
 
-void SdlPong::Body::SetVel(RigidBody rb) {
-    mRigidBody.xvel = rb.xvel;
-    mRigidBody.yvel = rb.yvel;
-}
+    mSim.setContinuousCollisions(true);
+    mSim.setProfiler(&mProfiler);
+
+    ResetInterpolation();
+
+    SdlPong::Color white{0xFF, 0xFF, 0xFF, 0xFF};
+    int ballH{static_cast<int>(mSim.getGraphicBox(SdlPong::ball).rect.h *
+                               mScaleY)};
+
+    SdlPong::Rect leftScoreRect{.x = static_cast<int>(screenWidth * 1 / 4.),
+                                .y = ballH,
+                                .w = 0,
+                                .h = 0};
+    SdlPong::GraphicBox leftScoreBox{.rect = leftScoreRect, .color = white};
+
+    SdlPong::Rect rightScoreRect{.x = static_cast<int>(screenWidth * 3. / 4.),
+                                 .y = ballH,
+                                 .w = 0,
+                                 .h = 0};
+    SdlPong::GraphicBox rightScoreBox{.rect = rightScoreRect, .color = white};
 
-SdlPong::RigidBody SdlPong::Body::GetVel() { return mRigidBody; }
+    mLeftScoreBody = new TextBody(mAtlas, leftScoreBox);
+    mRightScoreBody = new TextBody(mAtlas, rightScoreBox);
 
-void SdlPong::Body::Render(SDL_Renderer *renderer) {
-    SDL_FRect drawingRect{static_cast<float>(mGraphicBox.rect.x),
-                          static_cast<float>(mGraphicBox.rect.y),
-                          static_cast<float>(mGraphicBox.rect.w),
-                          static_cast<float>(mGraphicBox.rect.h)};
-    SDL_SetRenderDrawColor(renderer, mGraphicBox.color.r, mGraphicBox.color.g,
-                           mGraphicBox.color.b, mGraphicBox.color.a);
-    SDL_RenderFillRect(renderer, &drawingRect);
+    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "AppState initialized.");
 }
+/* }}} */
 
-SdlPong::Id SdlPong::Body::getId() { return mId; }
+/* SdlPong::AppState::~AppState {{{ */
+SdlPong::AppState::~AppState() {
+    StopSimThread();
+    delete mLeftScoreBody;
+    delete mRightScoreBody;
 
-/*void SdlPong::Body::RegisterCollision(SdlPong::Body *body) {{{
- * Figure out the position and velocity after collision.
- * Does not update them yet in order for other bodies to register collisions.
- * */
-void SdlPong::Body::RegisterCollision(SdlPong::Body *body) {
+    // Flush queued frames before the target goes away
+    mCapture.reset();
+    if (mCaptureSurface != nullptr) {
+        SDL_DestroyRenderer(mRenderer);
+        SDL_DestroySurface(mCaptureSurface);
+    }
+}
+/* }}} */
 
-    if (!(mId == SdlPong::ball || mId == SdlPong::leftBar ||
-          mId == SdlPong::rightBar)) {
-        assert(false && "Don't register collisions for walls");
+void SdlPong::AppState::startGame(bool ai) {
+    if (mPlayer || isRemote())
+        return;
+    if (mSimThread.joinable()) {
+        PushCommand({.kind = startCommand, .ai = ai});
+    } else {
+        StartGameNow(ai);
     }
+    // Force the score text to be rendered again; this must happen after the
+    // window and renderer are created
+    mLeftScoreShown = -1;
+    mRightScoreShown = -1;
+}
 
-    mCollided = true;
-    mPostCollisionPos = mGraphicBox.rect;
-    mPostCollisionXvel = mRigidBody.xvel;
-    mPostCollisionYvel = mRigidBody.yvel;
+// On whichever thread owns mSim
+void SdlPong::AppState::StartGameNow(bool ai) {
+    // The policy plays the left bar through its inputs, so as far as the
+    // Simulation and replays know this is a two-player game
+    mAIPolicyPlaying = ai && mAIPolicy;
+    bool builtInAI{ai && !mAIPolicy};
+    mSim.startGame(builtInAI);
+    if (mRecorder)
+        mRecorder->startGame(builtInAI);
+}
 
-    if (mId == SdlPong::ball) {
+/* void SdlPong::AppState::KeyEvent {{{ */
+void SdlPong::AppState::KeyEvent(SdlPong::InputKey key, bool pressed,
+                                 Uint64 timestampNS) {
+    if (!mSimThread.joinable()) {
+        mSampler.KeyEvent(key, pressed, timestampNS);
+        return;
+    }
 
-        // Bounces off left or right bar to the opposite direction
-        // (only setting post_vel to -vel may cause the ball to get stuck in the
-        // bar if it clipped too much
-        // Bounces off top or bottom wall
-        if (body->getId() == SdlPong::leftBar) {
+    PushCommand({.kind = keyCommand,
+                 .key = key,
+                 .pressed = pressed,
+                 .timestampNS = timestampNS});
+    if (pressed && mUnsampledPressNS == 0)
+        mUnsampledPressNS = timestampNS;
+} /* }}} */
 
-            mPostCollisionXvel = mPostCollisionXvel < 0 ? -mPostCollisionXvel
-                                                        : mPostCollisionXvel;
-            mPostCollisionYvel = body->GetVel().yvel;
+/* SDL_Window SdlPong::AppState::getWindow() {{{ */
+SDL_Window *SdlPong::AppState::getWindow() { return mWindow; } /* }}} */
 
-        } else if (body->getId() == SdlPong::rightBar) {
+/* SDL_Renderer SdlPong::AppState::getRenderer() {{{ */
+SDL_Renderer *SdlPong::AppState::getRenderer() { return mRenderer; } /* }}} */
 
-            mPostCollisionXvel = mPostCollisionXvel > 0 ? -mPostCollisionXvel
-                                                        : mPostCollisionXvel;
-            mPostCollisionYvel = body->GetVel().yvel;
+/* bool SdlPong::AppState::StartCapture {{{ */
+bool SdlPong::AppState::StartCapture(const std::string &path,
+                                     SdlPong::CaptureFormat format, int fps) {
+    assert(mCaptureSurface == nullptr && "Already capturing");
 
-        } else if (body->getId() == SdlPong::leftWall ||
-                   body->getId() == SdlPong::rightWall) {
+    const int w{mScreenWidth};
+    const int h{mScreenHeight};
 
-            // AppState handles this case
-            mCollided = false;
+    // Byte order R, G, B, A on every platform, as FrameWriter expects
+    mCaptureSurface = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
+    if (mCaptureSurface == nullptr) {
+        SDL_Log("Could not create capture surface! SDL error: %s\n",
+                SDL_GetError());
+        return false;
+    }
+    mRenderer = SDL_CreateSoftwareRenderer(mCaptureSurface);
+    if (mRenderer == nullptr) {
+        SDL_Log("Could not create software renderer! SDL error: %s\n",
+                SDL_GetError());
+        return false;
+    }
+    mWindow = nullptr;
 
-        } else if (body->getId() == SdlPong::topWall ||
-                   body->getId() == SdlPong::bottomWall) {
+    mCapture = std::make_unique<FrameWriter>(path, format, w, h, fps);
+    if (!mCapture->ok()) {
+        SDL_Log("Could not open %s for capture\n", path.c_str());
+        return false;
+    }
+    return true;
+} /* }}} */
 
-            mPostCollisionYvel = -mPostCollisionYvel;
+bool SdlPong::AppState::isCapturing() const { return mCapture != nullptr; }
 
-        } else {
-            assert(false && "Unknown collision body.");
-        }
-    } else if (mId == SdlPong::leftBar || mId == SdlPong::rightBar) {
+bool SdlPong::AppState::captureOk() const {
+    return mCapture != nullptr && mCapture->ok();
+}
 
-        // Stop bars from going out of bounds
+int SdlPong::AppState::getCapturedFrames() const { return mCapturedFrames; }
 
-        if (body->getId() == SdlPong::topWall) {
+void SdlPong::AppState::setRightPolicy(
+    std::unique_ptr<SdlPong::PaddlePolicy> policy) {
+    mRightPolicy = std::move(policy);
+}
 
-            mPostCollisionYvel = 0;
-            mPostCollisionPos.y =
-                body->GetCollisionBox()->y + body->GetCollisionBox()->h;
+void SdlPong::AppState::setAIPolicy(
+    std::unique_ptr<SdlPong::PaddlePolicy> policy) {
+    mAIPolicy = std::move(policy);
+}
 
-        } else if (body->getId() == SdlPong::bottomWall) {
+void SdlPong::AppState::StartRecording(const std::string &path) {
+    mRecorder = std::make_unique<ReplayRecorder>(mSim);
+    mRecordPath = path;
+}
 
-            mPostCollisionYvel = 0;
-            mPostCollisionPos.y =
-                body->GetCollisionBox()->y - mGraphicBox.rect.h;
+/* bool SdlPong::AppState::StopRecording() {{{ */
+bool SdlPong::AppState::StopRecording() {
+    // The recorder belongs to the simulation thread while it runs
+    StopSimThread();
+    if (!mRecorder)
+        return true;
+    bool saved{mRecorder->getReplay().save(mRecordPath)};
+    if (!saved)
+        SDL_Log("Could not write replay %s\n", mRecordPath.c_str());
+    mRecorder.reset();
+    return saved;
+} /* }}} */
 
-        } else {
-            assert(false && "Unknown collision body.");
-        }
+/* bool SdlPong::AppState::StartReplay(const std::string &path) {{{ */
+bool SdlPong::AppState::StartReplay(const std::string &path) {
+    if (!mReplay.load(path)) {
+        SDL_Log("Could not read replay %s\n", path.c_str());
+        return false;
     }
+    if (mReplay.tickRate != mSim.getTickRate()) {
+        SDL_Log("Replay %s was recorded at %d ticks per second; run with "
+                "--tick-rate %d\n",
+                path.c_str(), mReplay.tickRate, mReplay.tickRate);
+        return false;
+    }
+
+    mPlayer = std::make_unique<ReplayPlayer>(mReplay, mSim);
+    ResetInterpolation();
+    return true;
 } /* }}} */
 
-void SdlPong::Body::HandleCollision() {
+/* void SdlPong::AppState::SeekReplay(int deltaSeconds) {{{ */
+void SdlPong::AppState::SeekReplay(int deltaSeconds) {
+    if (!mPlayer)
+        return;
+    mPlayer->seek(mPlayer->getTick() + deltaSeconds * mSim.getTickRate());
+    ResetInterpolation();
+} /* }}} */
 
-    if (mCollided) {
-        mGraphicBox.rect = mPostCollisionPos;
-        mRigidBody.xvel = mPostCollisionXvel;
-        mRigidBody.yvel = mPostCollisionYvel;
-        mCollided = false;
-    }
-}
+bool SdlPong::AppState::isReplaying() const { return mPlayer != nullptr; }
 
-SdlPong::Body::~Body() {}
+bool SdlPong::AppState::isReplayFinished() const {
+    return mPlayer && mPlayer->isFinished();
+}
 
-SdlPong::TextBody::TextBody(std::string fontPath, GraphicBox gb)
-    : Body{gb, {}, {}}, mText{fontPath} {
+/* bool SdlPong::AppState::StartNetplay {{{ */
+bool SdlPong::AppState::StartNetplay(SdlPong::Side side,
+                                     const std::string &peerHost, int port) {
+#ifdef PONG_HAVE_NET
+    int localPort{side == SdlPong::left ? port : port + 1};
+    int remotePort{side == SdlPong::left ? port + 1 : port};
+    if (!mSocket.open(localPort, peerHost, remotePort)) {
+        SDL_Log("Could not open UDP port %d for peer %s\n", localPort,
+                peerHost.c_str());
+        return false;
+    }
+    mNetSide = side;
+    mNetplay = std::make_unique<RollbackSession>(mSim, side, mSocket);
+    ResetInterpolation();
+    return true;
+#else
+    static_cast<void>(side);
+    static_cast<void>(peerHost);
+    static_cast<void>(port);
+    SDL_Log("Netplay is not available on this platform\n");
+    return false;
+#endif
+} /* }}} */
 
-    constexpr int fontsize{28};
-    if (mFont = TTF_OpenFont(fontPath.c_str(), fontsize); mFont == nullptr) {
-        SDL_Log("Could not load %s! SDL_ttf Error: %s\n", fontPath.c_str(),
-                SDL_GetError());
-        assert(false && "Could not load font");
+/* bool SdlPong::AppState::JoinServer {{{ */
+bool SdlPong::AppState::JoinServer(const std::string &host, int port,
+                                   SdlPong::Opponent opponent) {
+#ifdef PONG_HAVE_NET
+    mServer = std::make_unique<MatchClient>();
+    if (!mServer->connect(host, port, opponent)) {
+        SDL_Log("Could not connect to server %s:%d\n", host.c_str(), port);
+        mServer.reset();
+        return false;
     }
-}
+    return true;
+#else
+    static_cast<void>(host);
+    static_cast<void>(port);
+    static_cast<void>(opponent);
+    SDL_Log("Server play is not available on this platform\n");
+    return false;
+#endif
+} /* }}} */
 
-void SdlPong::TextBody::Render(SDL_Renderer *renderer) {
-    // Set texture position
-    SDL_FRect dstRect = {static_cast<float>(mGraphicBox.rect.x),
-                         static_cast<float>(mGraphicBox.rect.y),
-                         static_cast<float>(mGraphicBox.rect.w),
-                         static_cast<float>(mGraphicBox.rect.h)};
-    // Render texture
-    SDL_RenderTexture(renderer, mFontTexture, NULL, &dstRect);
+bool SdlPong::AppState::isRemote() const {
+#ifdef PONG_HAVE_NET
+    return mNetplay || mServer;
+#else
+    return false;
+#endif
 }
 
-void SdlPong::TextBody::setText(std::string text, SDL_Renderer *renderer) {
+/* void SdlPong::AppState::StartSimThread() {{{ */
+void SdlPong::AppState::StartSimThread() {
+    if (mSimThread.joinable() || mPlayer || isRemote() || mCapture)
+        return;
+    mShownSim.loadState(mSim.saveState());
+    mShownTickEndNS = 0;
+    mSimStopping = false;
+    mSimThread = std::thread{[this] { SimLoop(); }};
+} /* }}} */
 
-    SDL_DestroyTexture(mFontTexture);
+/* void SdlPong::AppState::StopSimThread() {{{ */
+void SdlPong::AppState::StopSimThread() {
+    if (!mSimThread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock{mSimMutex};
+        mSimStopping = true;
+    }
+    mSimWake.notify_one();
+    mSimThread.join();
+
+    // Hand back to Update: key events still queued are replayed into the
+    // sampler, and rendering carries on from the thread's last tick
+    const auto apply{[this](const SimCommand &command) {
+        if (command.kind == keyCommand)
+            mSampler.KeyEvent(command.key, command.pressed,
+                              command.timestampNS);
+        else
+            StartGameNow(command.ai);
+    }};
+    while (std::optional<SimCommand> command = mCommands.pop())
+        apply(*command);
+    for (const SimCommand &command : mCommandBacklog)
+        apply(command);
+    mCommandBacklog.clear();
+    while (mImpactQueue.pop())
+        ;
+    ResetInterpolation();
+} /* }}} */
 
-    // Load text surface
-    if (SDL_Surface *textSurface =
-            TTF_RenderText_Blended(mFont, text.c_str(), 0, mGraphicBox.color);
-        textSurface == nullptr) {
-        SDL_Log("Unable to render text surface! SDL_ttf Error: %s\n",
-                SDL_GetError());
-    } else {
-        // Create texture from surface
-        if (mFontTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-            mFontTexture == nullptr) {
-            SDL_Log(
-                "Unable to create texture from rendered text! SDL Error: %s\n",
-                SDL_GetError());
-        } else {
-            mGraphicBox.rect.w = textSurface->w;
-            mGraphicBox.rect.h = textSurface->h;
+/* void SdlPong::AppState::SimLoop() {{{
+ * Body of the simulation thread: run each tick as soon as the wall-clock
+ * time it covers has passed, like Update does, and publish the result. Key
+ * events that arrive after their tick was sampled count for the next one.
+ * */
+void SdlPong::AppState::SimLoop() {
+    Uint64 tickEndNS{SDL_GetTicksNS() + mTickNS};
+    while (!mSimStopping.load(std::memory_order_relaxed)) {
+        const Uint64 nowNS{SDL_GetTicksNS()};
+        if (nowNS < tickEndNS) {
+            SDL_DelayPrecise(tickEndNS - nowNS);
+            continue;
+        }
+        // Do not fast-forward after a stall, see kMaxFrameNS
+        if (nowNS - tickEndNS > kMaxFrameNS)
+            tickEndNS = nowNS;
+
+        while (std::optional<SimCommand> command = mCommands.pop()) {
+            if (command->kind == keyCommand)
+                mSampler.KeyEvent(command->key, command->pressed,
+                                  command->timestampNS);
+            else
+                StartGameNow(command->ai);
         }
 
-        // Free temp surface
-        SDL_DestroySurface(textSurface);
+        SimFrame &frame{mFrames.back()};
+        for (int i{0}; i < kNumMovingBodies; ++i)
+            frame.prevBoxes[i] = mSim.getGraphicBox(kMovingBodies[i]);
+
+        mInputs = mSampler.Sample(tickEndNS);
+        LocalTick();
+        // Dropped if the frame loop is far behind; they are only effects
+        for (const SdlPong::Impact &impact : mSim.getImpacts())
+            mImpactQueue.push(impact);
+
+        frame.state = mSim.saveState();
+        frame.tickEndNS = tickEndNS;
+        mFrames.publish();
+        tickEndNS += mTickNS;
+
+        // Before the first game nothing moves until a key is pressed, so
+        // sleep until a command arrives instead of running empty ticks.
+        // The tick that takes it in runs at once.
+        if (IsStill(mSim)) {
+            std::unique_lock<std::mutex> lock{mSimMutex};
+            // Pairs with the fence in WakeSimThread: either it sees the flag
+            // or the check below sees its command
+            mSimParked.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            mSimWake.wait(lock, [this] {
+                return !mCommands.empty() || mSimStopping.load();
+            });
+            mSimParked.store(false, std::memory_order_relaxed);
+            tickEndNS = SDL_GetTicksNS();
+        }
     }
-}
+} /* }}} */
 
-SdlPong::TextBody::~TextBody() {
-    SDL_DestroyTexture(mFontTexture);
-    TTF_CloseFont(mFont);
+void SdlPong::AppState::PushCommand(const SimCommand &command) {
+    // The thread empties the queue every tick, so it is only full while the
+    // thread is behind. Rather than wait for it or lose a key release, keep
+    // the command until there is room again.
+    if (mCommandBacklog.empty() && mCommands.push(command)) {
+        WakeSimThread();
+        return;
+    }
+    mCommandBacklog.push_back(command);
+    FlushCommands();
 }
 
-/* SdlPong::AppState::AppState {{{ */
-SdlPong::AppState::AppState(int screenWidth, int screenHeight)
-    : mLeftScore{-1}, mRightScore{-1}, mAI{false},
-      barVel{static_cast<int>(screenHeight / 75.0)}, mBall{nullptr},
-      mLeftBar{nullptr}, mRightBar{nullptr}, mTopWall{nullptr},
-      mBottomWall{nullptr}, mLeftWall{nullptr}, mRightWall{nullptr} {
-    // SDL_AppInit will provide window and renderer
-
-    // Dimensions based on screen size
-    int ballW{static_cast<int>(screenWidth / 25.0)};
-    int ballH{ballW};
-
-    int barH{static_cast<int>(screenHeight / 6.0)};
-    int barW{ballW};
-
-    int TBwallH{kPadding};
-    int TBwallW{screenWidth};
-
-    int sideWallH{screenHeight};
-    int sideWallW{kPadding};
-
-    SDL_Color white{0xFF, 0xFF, 0xFF, 0xFF};
-    SdlPong::RigidBody stationery{.xvel = 0, .yvel = 0};
-
-    // Ball is in the middle of the screen
-    SDL_Rect ballRect{.x = static_cast<int>(screenWidth / 2. - ballW / 2.),
-                      .y = static_cast<int>(screenHeight / 2. - ballW / 2.),
-                      .w = ballW,
-                      .h = ballH};
-    SdlPong::GraphicBox ballBox{.rect = ballRect, .color = white};
-
-    SDL_Rect leftBarRect{.x = 0,
-                         .y = static_cast<int>(screenHeight / 2. - barH / 2.),
-                         .w = barW,
-                         .h = barH};
-    SdlPong::GraphicBox leftBarBox{.rect = leftBarRect, .color = white};
-    SDL_Rect rightBarRect{.x = screenWidth - barW,
-                          .y = static_cast<int>(screenHeight / 2. - barH / 2.),
-                          .w = barW,
-                          .h = barH};
-    SdlPong::GraphicBox rightBarBox{.rect = rightBarRect, .color = white};
-
-    SDL_Rect topWallRect{.x = 0, .y = -kPadding, .w = TBwallW, .h = TBwallH};
-    SdlPong::GraphicBox topWallBox{.rect = topWallRect, .color = white};
-    SDL_Rect bottomWallRect{
-        .x = 0, .y = screenHeight, .w = TBwallW, .h = TBwallH};
-    SdlPong::GraphicBox bottomWallBox{.rect = bottomWallRect, .color = white};
-
-    SDL_Rect leftWallRect{
-        .x = -kPadding, .y = 0, .w = sideWallW, .h = sideWallH};
-    SdlPong::GraphicBox leftWallBox{.rect = leftWallRect, .color = white};
-    SDL_Rect rightWallRect{
-        .x = screenWidth, .y = 0, .w = sideWallW, .h = sideWallH};
-    SdlPong::GraphicBox rightWallBox{.rect = rightWallRect, .color = white};
-
-    mBall = new Body(ballBox, stationery, SdlPong::ball);
-    mLeftBar = new Body(leftBarBox, stationery, SdlPong::leftBar);
-    mRightBar = new Body(rightBarBox, stationery, SdlPong::rightBar);
-
-    mTopWall = new Body(topWallBox, stationery, SdlPong::topWall);
-    mBottomWall = new Body(bottomWallBox, stationery, SdlPong::bottomWall);
-    mLeftWall = new Body(leftWallBox, stationery, SdlPong::leftWall);
-    mRightWall = new Body(rightWallBox, stationery, SdlPong::rightWall);
-
-    mBars[0] = mLeftBar;
-    mBars[1] = mRightBar;
-    mWalls[0] = mLeftWall;
-    mWalls[1] = mRightWall;
-    mWalls[2] = mTopWall;
-    mWalls[3] = mBottomWall;
-    mSideWalls[0] = mLeftWall;
-    mSideWalls[1] = mRightWall;
-    mTBWalls[0] = mTopWall;
-    mTBWalls[1] = mBottomWall;
-
-    // Font
-    std::string fontPath = "./slkscr.ttf";
-
-    SDL_Rect leftScoreRect{.x = static_cast<int>(screenWidth * 1 / 4.),
-                           .y = ballH,
-                           .w = 0,
-                           .h = 0};
-    SdlPong::GraphicBox leftScoreBox{.rect = leftScoreRect, .color = white};
-
-    SDL_Rect rightScoreRect{.x = static_cast<int>(screenWidth * 3. / 4.),
-                            .y = ballH,
-                            .w = 0,
-                            .h = 0};
-    SdlPong::GraphicBox rightScoreBox{.rect = rightScoreRect, .color = white};
+// Main thread only, keeps the order the commands were pushed in
+void SdlPong::AppState::FlushCommands() {
+    if (mCommandBacklog.empty())
+        return;
+    while (!mCommandBacklog.empty() &&
+           mCommands.push(mCommandBacklog.front()))
+        mCommandBacklog.pop_front();
+    WakeSimThread();
+}
 
-    mLeftScoreBody = new TextBody(fontPath, leftScoreBox);
-    mRightScoreBody = new TextBody(fontPath, rightScoreBox);
+void SdlPong::AppState::WakeSimThread() {
+    // Only a parked thread needs waking, so the lock stays off the input
+    // path while the game runs
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!mSimParked.load(std::memory_order_relaxed))
+        return;
+    // The thread holds the lock from setting the flag until it waits, so
+    // the notification cannot arrive before it sleeps
+    {
+        std::lock_guard<std::mutex> lock{mSimMutex};
+    }
+    mSimWake.notify_one();
+}
 
-    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "AppState initialized.");
+bool SdlPong::AppState::IsStill(const Simulation &sim) {
+    for (SdlPong::Id id : kMovingBodies) {
+        const SdlPong::RigidBody vel{sim.getVel(id)};
+        if (vel.xvel != 0 || vel.yvel != 0)
+            return false;
+    }
+    return true;
 }
-/* }}} */
 
-/* SdlPong::AppState::~AppState {{{ */
-SdlPong::AppState::~AppState() {
-    delete mBall;
-    delete mLeftBar;
-    delete mRightBar;
+/* void SdlPong::AppState::TakeSimFrame(Uint64 nowNS) {{{ */
+void SdlPong::AppState::TakeSimFrame(Uint64 nowNS) {
+    if (mFrames.update()) {
+        const SimFrame &frame{mFrames.front()};
+        mShownSim.loadState(frame.state);
+        for (int i{0}; i < kNumMovingBodies; ++i)
+            mPrevBoxes[i] = frame.prevBoxes[i];
+        mShownTickEndNS = frame.tickEndNS;
+
+        // A press is on screen once a tick ending after it is
+        if (mUnsampledPressNS != 0 && frame.tickEndNS > mUnsampledPressNS) {
+            if (mPendingPressNS == 0)
+                mPendingPressNS = mUnsampledPressNS;
+            mUnsampledPressNS = 0;
+        }
+    }
+    while (std::optional<SdlPong::Impact> impact = mImpactQueue.pop())
+        EmitImpact(*impact);
 
-    delete mTopWall;
-    delete mBottomWall;
-    delete mLeftWall;
-    delete mRightWall;
+    // Render interpolates by how far into the next tick the clock is
+    mAccumulatorNS = 0;
+    if (mShownTickEndNS != 0 && nowNS > mShownTickEndNS)
+        mAccumulatorNS = std::min(nowNS - mShownTickEndNS, mTickNS);
+} /* }}} */
 
-    delete mLeftScoreBody;
-    delete mRightScoreBody;
+const SdlPong::Simulation &SdlPong::AppState::Shown() const {
+    return mSimThread.joinable() ? mShownSim : mSim;
 }
-/* }}} */
 
-void SdlPong::AppState::startGame(bool ai) {
-    mAI = ai;
-    mBall->Reset();
-    mBall->SetVel({.xvel = barVel, .yvel = 0});
-    // incScore must be called at least once to render text, and it must be
-    // called after the window and renderer are created
-    mLeftScore = -1;
-    mRightScore = -1;
-    incScore(left);
-    incScore(right);
+SdlPong::Profiler &SdlPong::AppState::getProfiler() { return mProfiler; }
+
+void SdlPong::AppState::ToggleProfilerOverlay() {
+    mShowProfile = !mShowProfile;
+    mProfileAge = kProfileRefreshFrames;
+    mDirty = true;
 }
 
-/* void SdlPong::AppState::incScore(SdlPong::Side side) {{{ */
-void SdlPong::AppState::incScore(SdlPong::Side side) {
-    if (side == SdlPong::left) {
-        std::string scoreString = std::to_string(++mLeftScore);
-        mLeftScoreBody->setText(scoreString, mRenderer);
-    } else if (side == SdlPong::right) {
-        std::string scoreString = std::to_string(++mRightScore);
-        mRightScoreBody->setText(scoreString, mRenderer);
-    }
-} /* }}} */
+/* bool SdlPong::AppState::WriteProfile(const std::string &path) {{{ */
+bool SdlPong::AppState::WriteProfile(const std::string &path) {
+    std::ostringstream table;
+    mProfiler.report(table);
+    SDL_Log("Frame profile:\n%s", table.str().c_str());
 
-/* void SdlPong::AppState::decScore(SdlPong::Side side) {{{ */
-void SdlPong::AppState::decScore(SdlPong::Side side) {
-    if (side == SdlPong::left) {
-        std::string scoreString = std::to_string(--mLeftScore);
-        mLeftScoreBody->setText(scoreString, mRenderer);
-    } else if (side == SdlPong::right) {
-        std::string scoreString = std::to_string(--mRightScore);
-        mRightScoreBody->setText(scoreString, mRenderer);
+    if (!mProfiler.WriteChromeTrace(path)) {
+        SDL_Log("Could not write trace %s\n", path.c_str());
+        return false;
     }
+    return true;
 } /* }}} */
 
-void SdlPong::AppState::moveBar(SdlPong::Side side, SdlPong::BarDirection dir) {
-    SdlPong::RigidBody newRb{0, 0};
-    switch (dir) {
-    case SdlPong::up:
-        newRb.yvel = -barVel;
-        break;
-    case SdlPong::down:
-        newRb.yvel = barVel;
-        break;
-    case SdlPong::none:
-        newRb.yvel = 0;
-        break;
-    default:
-        assert(false && "Invaild direction");
-    }
-    if (side == SdlPong::left && (!mAI))
-        mLeftBar->SetVel(newRb);
-    else if (side == SdlPong::right)
-        mRightBar->SetVel(newRb);
+void SdlPong::AppState::setMeasureLatency(bool enabled) {
+    mMeasureLatency = enabled;
 }
 
-/* SDL_Window SdlPong::AppState::getWindow() {{{ */
-SDL_Window *SdlPong::AppState::getWindow() { return mWindow; } /* }}} */
-
-/* SDL_Renderer SdlPong::AppState::getRenderer() {{{ */
-SDL_Renderer *SdlPong::AppState::getRenderer() { return mRenderer; } /* }}} */
-
-/* void SdlPong::AppState::UpdatePositions() {{{ */
-void SdlPong::AppState::UpdatePositions() {
-    mBall->UpdatePos();
-    if (mAI) { // elementary AI
-        SdlPong::RigidBody newRb{0, 0};
-        if (mBall->GetCollisionBox()->y - mLeftBar->GetCollisionBox()->y > 0)
-            newRb.yvel = barVel;
-        else if (mBall->GetCollisionBox()->y - mLeftBar->GetCollisionBox()->y <
-                 0)
-            newRb.yvel = -barVel;
-        else
-            newRb.yvel = 0;
-        mLeftBar->SetVel(newRb);
-    }
-    mLeftBar->UpdatePos();
-    mRightBar->UpdatePos();
+/* void SdlPong::AppState::ReportLatency() {{{ */
+void SdlPong::AppState::ReportLatency() {
+    if (!mMeasureLatency || mLatenciesNS.empty())
+        return;
+
+    std::vector<Uint64> sorted{mLatenciesNS};
+    std::sort(sorted.begin(), sorted.end());
+    auto ms = [&sorted](double p) {
+        return sorted[static_cast<std::size_t>(
+                   p * static_cast<double>(sorted.size() - 1))] /
+               1e6;
+    };
+    SDL_Log("Input to present latency over %zu presses: p50 %.2f ms, "
+            "p99 %.2f ms, max %.2f ms\n",
+            sorted.size(), ms(0.50), ms(0.99), sorted.back() / 1e6);
 } /* }}} */
 
-/* void SdlPong::AppState::CheckCollisions() {{{ */
-void SdlPong::AppState::CheckCollisions() {
+/* void SdlPong::AppState::Update(Uint64 nowNS) {{{ */
+void SdlPong::AppState::Update(Uint64 nowNS) {
+    Uint64 frameNS{mLastNS == 0 ? 0 : nowNS - mLastNS};
+    mLastNS = nowNS;
+    mAccumulatorNS += frameNS < kMaxFrameNS ? frameNS : kMaxFrameNS;
 
-    // Collisions to check:
-    // ball against bars
-    // ball against walls
-    // bars against top and bottom wall
+    mParticles.Update(static_cast<float>(frameNS) / SDL_NS_PER_SECOND);
 
-    for (int i{0}; i < kNumBars; ++i) {
+    if (mSimThread.joinable()) {
+        FlushCommands();
+        TakeSimFrame(nowNS);
+        return;
+    }
 
-        if (SDL_HasRectIntersection(mBars[i]->GetCollisionBox(),
-                                    mBall->GetCollisionBox())) {
-            mBall->RegisterCollision(mBars[i]);
+#ifdef PONG_HAVE_NET
+    // Take in remote input even on frames without a tick
+    if (mNetplay)
+        mNetplay->poll();
+    if (mServer && mServer->isConnected()) {
+        const bool wasPlaying{mServer->isPlaying()};
+        if (!mServer->poll())
+            SDL_Log("Lost the connection to the server\n");
+        else if (!wasPlaying && mServer->isPlaying() &&
+                 mServer->getTickRate() != mSim.getTickRate())
+            SDL_Log("Server runs at %d ticks per second; run with "
+                    "--tick-rate %d for the smoothest play\n",
+                    mServer->getTickRate(), mServer->getTickRate());
+    }
+#endif
+
+    while (mAccumulatorNS >= mTickNS) {
+        ResetInterpolation();
+        // Wall-clock time at which this tick ends
+        Uint64 tickEndNS{nowNS - mAccumulatorNS + mTickNS};
+        mAccumulatorNS -= mTickNS;
+
+        mInputs = mSampler.Sample(tickEndNS);
+        if (mPendingPressNS == 0)
+            mPendingPressNS = mSampler.getFirstPressNS();
+
+        if (mPlayer) {
+            mPlayer->step();
+            EmitImpacts();
+            continue;
         }
 
-        for (int j{0}; j < kNumSideWalls; ++j) {
-            if (SDL_HasRectIntersection(mBall->GetCollisionBox(),
-                                        mSideWalls[j]->GetCollisionBox())) {
-                // AppState handles this case
-                mBall->Reset();
-                if (mSideWalls[j]->getId() == SdlPong::leftWall) {
-                    incScore(SdlPong::right);
-                    mBall->SetVel({.xvel = -barVel, .yvel = 0});
-                } else if (mSideWalls[j]->getId() == SdlPong::rightWall) {
-                    incScore(SdlPong::left);
-                    mBall->SetVel({.xvel = barVel, .yvel = 0});
-                }
+#ifdef PONG_HAVE_NET
+        if (mServer) {
+            // The server simulates; show the newest state it sent back
+            BarDirection local{mServer->getSide() == SdlPong::left
+                                   ? mInputs.left
+                                   : mInputs.right};
+            mServer->sendInput(local);
+            if (mServer->getStateTick() > mServerTick) {
+                mServerTick = mServer->getStateTick();
+                mSim.loadState(mServer->getState());
             }
+            continue;
         }
-        for (int j{0}; j < kNumTBWalls; ++j) {
-            if (SDL_HasRectIntersection(mBall->GetCollisionBox(),
-                                        mTBWalls[j]->GetCollisionBox()))
-                mBall->RegisterCollision(mTBWalls[j]);
-            if (SDL_HasRectIntersection(mBars[i]->GetCollisionBox(),
-                                        mTBWalls[j]->GetCollisionBox()))
-                mBars[i]->RegisterCollision(mTBWalls[j]);
+
+        if (mNetplay) {
+            BarDirection local{mNetSide == SdlPong::left ? mInputs.left
+                                                         : mInputs.right};
+            if (!mNetplay->step(local)) {
+                // Wait for the peer rather than bank time to catch up with
+                mAccumulatorNS = 0;
+                break;
+            }
+            EmitImpacts();
+            continue;
         }
+#endif
+
+        LocalTick();
+        EmitImpacts();
     }
+} /* }}} */
 
+// One tick of local play with mInputs from the sampler, on whichever thread
+// owns mSim
+void SdlPong::AppState::LocalTick() {
+    if (mAIPolicyPlaying)
+        mInputs.left = mAIPolicy->act(mSim, SdlPong::left);
+    if (mRightPolicy)
+        mInputs.right = mRightPolicy->act(mSim, SdlPong::right);
+    mSim.step(mInputs);
+    if (mRecorder)
+        mRecorder->step(mSim, mInputs);
+}
+
+/* void SdlPong::AppState::EmitImpacts() {{{
+ * Sparks where the ball bounced in the last tick, and a bigger burst where
+ * it left the field
+ * */
+void SdlPong::AppState::EmitImpacts() {
+    for (const SdlPong::Impact &impact : mSim.getImpacts())
+        EmitImpact(impact);
+} /* }}} */
+
+void SdlPong::AppState::EmitImpact(const SdlPong::Impact &impact) {
+    constexpr SDL_FColor white{1, 1, 1, 1};
+    float x{impact.x * mScaleX};
+    float y{impact.y * mScaleY};
+    if (impact.kind == SdlPong::scoreImpact)
+        mParticles.Burst(x, y, kScoreParticles, 600.0f, white);
+    else
+        mParticles.Burst(x, y, kBounceParticles, 300.0f, white);
+}
+
+// Draw bodies where they are now, without blending in the previous tick
+void SdlPong::AppState::ResetInterpolation() {
+    for (int i{0}; i < kNumMovingBodies; ++i)
+        mPrevBoxes[i] = mSim.getGraphicBox(kMovingBodies[i]);
+}
+
+/* void SdlPong::AppState::UpdateScoreText() {{{ */
+void SdlPong::AppState::UpdateScoreText() {
+    // Only lay out text when a score actually changed
+    char digits[16];
+    const Simulation &sim{Shown()};
+    if (int score = sim.getScore(SdlPong::left); score != mLeftScoreShown) {
+        SdlPong::ProfileScope scope{&mProfiler, SdlPong::setTextPhase};
+        char *end{std::to_chars(digits, digits + sizeof(digits), score).ptr};
+        mLeftScoreBody->setText(
+            {digits, static_cast<std::size_t>(end - digits)});
+        mLeftScoreShown = score;
+    }
+    if (int score = sim.getScore(SdlPong::right); score != mRightScoreShown) {
+        SdlPong::ProfileScope scope{&mProfiler, SdlPong::setTextPhase};
+        char *end{std::to_chars(digits, digits + sizeof(digits), score).ptr};
+        mRightScoreBody->setText(
+            {digits, static_cast<std::size_t>(end - digits)});
+        mRightScoreShown = score;
+    }
 } /* }}} */
-/* void SdlPong::AppState::ProcessCollisions() {{{ */
-void SdlPong::AppState::ProcessCollisions() {
 
-    for (int i{0}; i < kNumBars; ++i) {
-        mBars[i]->HandleCollision();
+/* void SdlPong::AppState::RenderBox {{{
+ * Queue a body between its previous and current tick positions.
+ * */
+void SdlPong::AppState::RenderBox(const SdlPong::GraphicBox &prev,
+                                  const SdlPong::GraphicBox &cur,
+                                  float alpha) {
+    float x{static_cast<float>(cur.rect.x)};
+    float y{static_cast<float>(cur.rect.y)};
+    int dx{cur.rect.x - prev.rect.x};
+    int dy{cur.rect.y - prev.rect.y};
+    if (dx < mLerpLimit && -dx < mLerpLimit && dy < mLerpLimit &&
+        -dy < mLerpLimit) {
+        x = prev.rect.x + dx * alpha;
+        y = prev.rect.y + dy * alpha;
     }
-    mBall->HandleCollision();
 
+    SDL_FRect drawingRect{x * mScaleX, y * mScaleY,
+                          static_cast<float>(cur.rect.w) * mScaleX,
+                          static_cast<float>(cur.rect.h) * mScaleY};
+    mQueue.AddRect(drawingRect, ToFColor(cur.color));
 } /* }}} */
 
 /* void SdlPong::AppState::Render() {{{ */
 void SdlPong::AppState::Render() {
+    const std::uint64_t renderStartNS{mProfiler.now()};
 
     // Clear all
     SDL_SetRenderDrawColor(mRenderer, 0x00, 0x00, 0x00, 0xFF);
     SDL_RenderClear(mRenderer);
 
-    mBall->Render(mRenderer);
-    mLeftBar->Render(mRenderer);
-    mRightBar->Render(mRenderer);
+    // Fraction of a tick that has elapsed since the last simulated state
+    float alpha{static_cast<float>(mAccumulatorNS) /
+                static_cast<float>(mTickNS)};
+    const Simulation &sim{Shown()};
+    for (int i{0}; i < kNumMovingBodies; ++i)
+        RenderBox(mPrevBoxes[i], sim.getGraphicBox(kMovingBodies[i]), alpha);
+    mParticles.Render(mQueue);
 
     // Render scores
-    mLeftScoreBody->Render(mRenderer);
-    mRightScoreBody->Render(mRenderer);
+    if (sim.getScore(SdlPong::left) >= 0) {
+        UpdateScoreText();
+        mLeftScoreBody->Render(mRenderer, mQueue);
+        mRightScoreBody->Render(mRenderer, mQueue);
+    }
+
+    mQueue.Submit(mRenderer);
+
+    if (mShowProfile)
+        RenderProfilerOverlay();
+
+    mProfiler.record(SdlPong::renderPhase, renderStartNS, mProfiler.now());
 
     // Update screen
+    const std::uint64_t presentStartNS{mProfiler.now()};
     SDL_RenderPresent(mRenderer);
+    mProfiler.record(SdlPong::presentPhase, presentStartNS, mProfiler.now());
+
+    if (mMeasureLatency && mPendingPressNS != 0) {
+        mLatenciesNS.push_back(SDL_GetTicksNS() - mPendingPressNS);
+        mPendingPressNS = 0;
+        if (mLatenciesNS.size() % kLatencyReportInterval == 0)
+            ReportLatency();
+    }
 
+    if (mCapture)
+        CaptureFrame();
+
+    mPresentedState = sim.saveState();
+    mDirty = false;
+} /* }}} */
+
+void SdlPong::AppState::Wake(Uint64 nowNS) {
+    mWakeNS = nowNS;
+    mDirty = true;
+}
+
+/* bool SdlPong::AppState::isIdle(Uint64 nowNS) const {{{
+ * Before the first game the ball does not move, and bars held against a
+ * wall stand still, so the screen only changes again after an event.
+ * Remote play and replays change without one.
+ * */
+bool SdlPong::AppState::isIdle(Uint64 nowNS) const {
+    if (mCapture || isRemote() || (mPlayer && !mPlayer->isFinished()))
+        return false;
+    if (mShowProfile || mParticles.size() > 0)
+        return false;
+    if (mWakeNS != 0 && nowNS - mWakeNS < kWakeNS)
+        return false;
+
+    const Simulation &sim{Shown()};
+    if (!IsStill(sim))
+        return false;
+    // Still drawn between two positions
+    for (int i{0}; i < kNumMovingBodies; ++i) {
+        const SdlPong::Rect rect{sim.getGraphicBox(kMovingBodies[i]).rect};
+        if (rect.x != mPrevBoxes[i].rect.x || rect.y != mPrevBoxes[i].rect.y)
+            return false;
+    }
+    return true;
+} /* }}} */
+
+bool SdlPong::AppState::isDirty() const {
+    return mDirty || Shown().saveState() != mPresentedState;
+}
+
+/* void SdlPong::AppState::RenderProfilerOverlay() {{{
+ * Timing table in SDL's built-in debug font, refreshed a few times a second
+ * since summarizing sorts the whole ring.
+ * */
+void SdlPong::AppState::RenderProfilerOverlay() {
+    if (++mProfileAge >= kProfileRefreshFrames) {
+        mProfileAge = 0;
+        SdlPong::PhaseStats stats[kNumProfilePhases];
+        mProfiler.Summarize(stats);
+        for (int phase{0}; phase < kNumProfilePhases; ++phase)
+            std::snprintf(mProfileText[phase], sizeof(mProfileText[phase]),
+                          "%-17s %6.3f %6.3f %6.3f",
+                          ProfilePhaseName(static_cast<ProfilePhase>(phase)),
+                          stats[phase].p50Ms, stats[phase].p99Ms,
+                          stats[phase].maxMs);
+    }
+
+    constexpr float lineHeight{10};
+    SDL_SetRenderDrawColor(mRenderer, 0x00, 0xFF, 0x00, 0xFF);
+    // Columns line up with the format above
+    SDL_RenderDebugText(mRenderer, 8, 8,
+                        "ms                   p50    p99    max");
+    for (int phase{0}; phase < kNumProfilePhases; ++phase)
+        SDL_RenderDebugText(mRenderer, 8, 8 + lineHeight * (phase + 1),
+                            mProfileText[phase]);
+} /* }}} */
+
+/* void SdlPong::AppState::CaptureFrame() {{{
+ * Copy the finished frame into the writer's ring; only blocks when the
+ * writer is a full ring behind.
+ * */
+void SdlPong::AppState::CaptureFrame() {
+    const int w{mCaptureSurface->w};
+    const std::size_t rowBytes{static_cast<std::size_t>(w) * 4};
+
+    std::uint8_t *frame{mCapture->acquire()};
+    SDL_LockSurface(mCaptureSurface);
+    const auto *src{static_cast<const std::uint8_t *>(mCaptureSurface->pixels)};
+    for (int y{0}; y < mCaptureSurface->h; ++y)
+        std::memcpy(frame + y * rowBytes,
+                    src + static_cast<std::size_t>(y) * mCaptureSurface->pitch,
+                    rowBytes);
+    SDL_UnlockSurface(mCaptureSurface);
+    mCapture->submit();
+
+    ++mCapturedFrames;
 } /* }}} */
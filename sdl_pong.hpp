@@ -1,144 +1,311 @@
 #ifndef _JC_SDL_PONG
+#define _JC_SDL_PONG
 
 #include "SDL3/SDL_pixels.h"
 #include "SDL3/SDL_rect.h"
 #include "SDL3/SDL_render.h"
 #include "SDL3/SDL_video.h"
+#include "asset_cache.hpp"
+#include "frame_writer.hpp"
+#include "glyph_atlas.hpp"
+#include "input_sampler.hpp"
+#include "match_protocol.hpp"
+#include "paddle_policy.hpp"
+#include "particle_system.hpp"
+#include "pong_sim.hpp"
+#include "profiler.hpp"
+#include "render_queue.hpp"
+#include "replay.hpp"
+#include "spsc_queue.hpp"
+#include "triple_buffer.hpp"
 #include <SDL3/SDL.h>
 #include <SDL3_ttf/SDL_ttf.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
-namespace SdlPong {
-
-enum Side {
-    left,
-    right,
-};
-
-enum BarDirection { up, down, none };
-
-enum Id {
-    ball,
-    leftBar,
-    rightBar,
-    topWall,
-    bottomWall,
-    leftWall,
-    rightWall,
-};
+#ifdef PONG_HAVE_NET
+#include "match_client.hpp"
+#include "netplay.hpp"
+#endif
 
-struct GraphicBox {
-    SDL_Rect rect; // size and position
-    SDL_Color color;
-};
+namespace SdlPong {
 
-struct RigidBody { // velocity
-    int xvel;
-    int yvel;
-};
+SDL_FColor ToFColor(Color color);
 
-class Body {
+// Short line of text drawn from a shared glyph atlas
+class TextBody {
   public:
-    Body(GraphicBox gb, RigidBody rb, Id id);
-    ~Body();
-
-    void UpdatePos();
-    SDL_Rect *GetCollisionBox();
-    void SetVel(RigidBody rb);
-    RigidBody GetVel();
-    void Render(SDL_Renderer *renderer);
-    Id getId();
-    void RegisterCollision(Body *body);
-    void HandleCollision();
-    void Reset();
-
-  protected:
-    GraphicBox mGraphicBox;
-    RigidBody mRigidBody;
-    Id mId;
+    TextBody(GlyphAtlas *atlas, GraphicBox gb);
+    // Longer text is cut off at kMaxTextLength characters
+    void setText(std::string_view text);
+    void Render(SDL_Renderer *renderer, RenderQueue &queue);
 
   private:
-    SDL_Rect mPostCollisionPos{};
-    int mPostCollisionXvel{};
-    int mPostCollisionYvel{};
-    bool mCollided{false};
-    GraphicBox mInitGraphicBox;
-    RigidBody mInitRigidBody;
-};
-
-class TextBody : Body {
-  public:
-    TextBody(std::string fontPath, GraphicBox gb);
-    ~TextBody();
-    void setText(std::string text, SDL_Renderer *renderer);
-    void Render(SDL_Renderer *renderer);
+    static constexpr int kMaxTextLength{15};
 
-  private:
-    std::string mText;
-    TTF_Font *mFont;
-    SDL_Texture *mFontTexture;
+    GlyphAtlas *mAtlas;
+    GraphicBox mGraphicBox;
+    char mText[kMaxTextLength];
+    int mLength{0};
 };
 
+// SDL front end: owns the window, renderer and score text, and feeds player
+// input into a headless Simulation
 class AppState {
 
   public:
-    AppState(int screenWidth, int screenHeight);
+    AppState(int screenWidth, int screenHeight,
+             int tickRate = kBaseTickRate);
 
     void startGame(bool ai);
 
-    void incScore(Side side);
-    void decScore(Side side);
-    void moveBar(Side side, BarDirection dir);
+    // A bar key went down or up at timestampNS, on the SDL_GetTicksNS
+    // clock
+    void KeyEvent(InputKey key, bool pressed, Uint64 timestampNS);
 
     SDL_Window *getWindow();
     SDL_Renderer *getRenderer();
 
-    void UpdatePositions();
-    void CheckCollisions();
-    void ProcessCollisions();
+    // Render into an offscreen software surface instead of a window and
+    // stream every frame to path. Used in place of creating a window.
+    bool StartCapture(const std::string &path, CaptureFormat format,
+                      int fps);
+    bool isCapturing() const;
+    // False once the frame writer failed
+    bool captureOk() const;
+    // Frames handed to the writer so far
+    int getCapturedFrames() const;
+
+    // Drive the right bar with a policy instead of key presses
+    void setRightPolicy(std::unique_ptr<PaddlePolicy> policy);
+    // Opponent for one-player games in place of the Simulation's built-in
+    // AI; null restores the built-in one
+    void setAIPolicy(std::unique_ptr<PaddlePolicy> policy);
+
+    // Record every tick from now on; StopRecording writes the file
+    void StartRecording(const std::string &path);
+    bool StopRecording();
+
+    // Play a recorded match instead of taking input. Fails if the file was
+    // recorded at another tick rate.
+    bool StartReplay(const std::string &path);
+    // Jump forwards or backwards in the replay
+    void SeekReplay(int deltaSeconds);
+    bool isReplaying() const;
+    bool isReplayFinished() const;
+
+    // Play side against a peer running the same game for the other side.
+    // The left peer listens on port and the right one on port + 1. Network
+    // play fails on platforms built without it, see PONG_HAVE_NET.
+    bool StartNetplay(Side side, const std::string &peerHost, int port);
+
+    // Play a match hosted by pong_server at host:port instead of running
+    // the simulation here. The server picks the side once an opponent is
+    // found, or straight away against its AI.
+    bool JoinServer(const std::string &host, int port, Opponent opponent);
+
+    // Run local play on a thread of its own from now on, so a slow frame
+    // cannot hold up the simulation. Key presses reach it through a
+    // lock-free queue and Update only picks up the newest finished tick.
+    // Does nothing during replays, netplay, server play or capture, which
+    // stay in step with the frame loop.
+    void StartSimThread();
+    // Wait for the simulation thread, after which Update steps the
+    // simulation itself again
+    void StopSimThread();
+
+    // Phase timings of the frame loop and the simulation
+    Profiler &getProfiler();
+    void ToggleProfilerOverlay();
+    // Log the timing table and write a Chrome trace to path
+    bool WriteProfile(const std::string &path);
+
+    // Time from each key press to the SDL_RenderPresent of the first frame
+    // that includes it
+    void setMeasureLatency(bool enabled);
+    // Log p50/p99/max of the latencies measured so far
+    void ReportLatency();
+
+    // Run as many fixed-length ticks as the time since the last call allows
+    void Update(Uint64 nowNS);
     void Render();
 
+    // An input or window event arrived at nowNS: draw the next frame, and
+    // keep drawing for kWakeNS so that whatever the event set off shows
+    void Wake(Uint64 nowNS);
+    // Nothing on screen moves or is about to, so the frame loop can wait
+    // for the next event instead of drawing identical frames
+    bool isIdle(Uint64 nowNS) const;
+    // The last presented frame no longer matches the scene
+    bool isDirty() const;
+
     ~AppState();
 
     SDL_Window *mWindow;
     SDL_Renderer *mRenderer;
 
   private:
-    // Outer padding for collision boxes
-    static constexpr int kPadding{10};
-
-    static constexpr int kNumBars{2};
-    static constexpr int kNumWalls{4};
-    static constexpr int kNumTBWalls{2};
-    static constexpr int kNumSideWalls{2};
-
-    bool mAI;
-
-    int barVel;
-
-    int mLeftScore;
-    int mRightScore;
+    // Longest stretch of wall-clock time simulated in one Update, so a stall
+    // does not make the game fast-forward
+    static constexpr Uint64 kMaxFrameNS{250 * SDL_NS_PER_MS};
+
+    // Time after an event during which frames are drawn even if nothing
+    // moves yet, long enough for the simulation thread to act on it
+    static constexpr Uint64 kWakeNS{250 * SDL_NS_PER_MS};
+
+    // Bodies that move and are interpolated when rendering
+    static constexpr Id kMovingBodies[] = {ball, leftBar, rightBar};
+    static constexpr int kNumMovingBodies{3};
+
+    static constexpr float kFontSize{28};
+
+    // Particles thrown out by a bounce and by a point being scored
+    static constexpr int kBounceParticles{24};
+    static constexpr int kScoreParticles{400};
+
+    // Frames between refreshes of the profiler overlay text
+    static constexpr int kProfileRefreshFrames{30};
+
+    // Key presses between latency reports
+    static constexpr int kLatencyReportInterval{20};
+
+    // Key presses and game starts for the simulation thread
+    enum SimCommandKind { keyCommand, startCommand };
+    struct SimCommand {
+        SimCommandKind kind;
+        InputKey key{leftUpKey}; // keyCommand
+        bool pressed{false};
+        Uint64 timestampNS{0};
+        bool ai{false}; // startCommand
+    };
+
+    // What the simulation thread hands over after every tick
+    struct SimFrame {
+        SimState state;
+        GraphicBox prevBoxes[kNumMovingBodies]; // before the tick
+        Uint64 tickEndNS;
+    };
+
+    static constexpr int kCommandCapacity{256};
+    static constexpr int kImpactCapacity{256};
+
+    void StartGameNow(bool ai);
+    // Queue a command for the simulation thread and wake it if it sleeps
+    void PushCommand(const SimCommand &command);
+    // Move commands that did not fit in the queue into it
+    void FlushCommands();
+    // Lock-free unless the thread is parked waiting for a command
+    void WakeSimThread();
+    // Playing against a peer or on a server
+    bool isRemote() const;
+    // No body moves, so ticks change nothing until an input does
+    static bool IsStill(const Simulation &sim);
+    void LocalTick();
+    void SimLoop();
+    void TakeSimFrame(Uint64 nowNS);
+    // The simulation Render shows, a copy of the thread's while it runs
+    const Simulation &Shown() const;
+
+    void RenderBox(const GraphicBox &prev, const GraphicBox &cur,
+                   float alpha);
+    void UpdateScoreText();
+    void CaptureFrame();
+    void ResetInterpolation();
+    void EmitImpacts();
+    void EmitImpact(const Impact &impact);
+    void RenderProfilerOverlay();
+
+    int mScreenWidth;
+    int mScreenHeight;
+    // Pixels per Fixed world unit, the field fills the window
+    float mScaleX;
+    float mScaleY;
+
+    Profiler mProfiler;
+    bool mShowProfile{false};
+    int mProfileAge{0}; // frames since the overlay text was refreshed
+    char mProfileText[kNumProfilePhases][64]{};
+
+    Simulation mSim;
+    InputSampler mSampler;
+    Inputs mInputs; // of the last tick
+    std::unique_ptr<PaddlePolicy> mRightPolicy;
+    std::unique_ptr<PaddlePolicy> mAIPolicy;
+    bool mAIPolicyPlaying{false}; // the current game is against mAIPolicy
+
+    Uint64 mTickNS;
+    Uint64 mLastNS{0};
+    Uint64 mAccumulatorNS{0};
+
+    // State before the last tick, for interpolation
+    GraphicBox mPrevBoxes[kNumMovingBodies];
+    int mLerpLimit; // larger jumps are teleports and are not interpolated
+
+    // Local play on its own thread. While it runs the thread owns mSim,
+    // mSampler, mInputs, the policies and mRecorder.
+    std::thread mSimThread;
+    std::atomic<bool> mSimStopping{false};
+    SpscQueue<SimCommand, kCommandCapacity> mCommands;
+    // Main thread only: commands waiting for room in mCommands
+    std::deque<SimCommand> mCommandBacklog;
+    // The thread sleeps on this while the game is still, see SimLoop
+    std::mutex mSimMutex;
+    std::condition_variable mSimWake;
+    std::atomic<bool> mSimParked{false};
+    SpscQueue<Impact, kImpactCapacity> mImpactQueue;
+    TripleBuffer<SimFrame> mFrames;
+    Simulation mShownSim;     // last frame taken from mFrames
+    Uint64 mShownTickEndNS{0};
+    Uint64 mUnsampledPressNS{0}; // earliest press the thread may not have
+
+    ParticleSystem mParticles;
+    AssetCache mAssets;
+    GlyphAtlas *mAtlas; // owned by mAssets
+    RenderQueue mQueue;
+
+    // Scores currently shown by the text bodies
+    int mLeftScoreShown;
+    int mRightScoreShown;
 
     TextBody *mLeftScoreBody;
     TextBody *mRightScoreBody;
 
-    Body *mBall;
-    Body *mLeftBar;
-    Body *mRightBar;
-
-    // invisible bodies
-    Body *mTopWall;
-    Body *mBottomWall;
-    Body *mLeftWall;
-    Body *mRightWall;
-
-    // For interating through
-    Body *mBars[kNumBars] = {mLeftBar, mRightBar};
-    Body *mWalls[kNumWalls] = {mLeftWall, mRightWall, mTopWall, mBottomWall};
-    Body *mSideWalls[kNumSideWalls] = {mLeftWall, mRightWall};
-    Body *mTBWalls[kNumTBWalls] = {mTopWall, mBottomWall};
+    // Offscreen target and writer, only while capturing
+    SDL_Surface *mCaptureSurface{nullptr};
+    std::unique_ptr<FrameWriter> mCapture;
+    int mCapturedFrames{0};
+
+    std::unique_ptr<ReplayRecorder> mRecorder;
+    std::string mRecordPath;
+    Replay mReplay;
+    std::unique_ptr<ReplayPlayer> mPlayer;
+
+#ifdef PONG_HAVE_NET
+    UdpSocket mSocket;
+    std::unique_ptr<RollbackSession> mNetplay;
+    Side mNetSide{left};
+
+    std::unique_ptr<MatchClient> mServer;
+    int mServerTick{-1}; // of the state last loaded into mSim
+#endif
+
+    // What the last presented frame showed
+    SimState mPresentedState{};
+    bool mDirty{true}; // something not in mPresentedState changed
+    Uint64 mWakeNS{0};
+
+    bool mMeasureLatency{false};
+    Uint64 mPendingPressNS{0}; // earliest press not yet presented
+    std::vector<Uint64> mLatenciesNS;
 };
 
 } // namespace SdlPong
 
-#endif /* ifndef  */
+#endif /* ifndef _JC_SDL_PONG */
@@ -0,0 +1,74 @@
+#include "match_server.hpp"
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+// Dedicated match server: hosts any number of games for sdl_pong --connect
+
+namespace {
+
+volatile std::sig_atomic_t gQuit{0};
+
+void OnSignal(int) { gQuit = 1; }
+
+// Seconds between status lines
+constexpr int kReportSeconds{10};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    SdlPong::ServerConfig config;
+
+    for (int i{1}; i < argc - 1; i += 2) {
+        if (std::strcmp(argv[i], "--port") == 0)
+            config.port = std::atoi(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--threads") == 0)
+            config.numWorkers = std::atoi(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--tick-rate") == 0)
+            config.tickRate = std::atoi(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--points") == 0)
+            config.pointsToWin = std::atoi(argv[i + 1]);
+        else {
+            std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (config.port <= 0 || config.port > 65535 || config.tickRate <= 0 ||
+        config.pointsToWin <= 0) {
+        std::fprintf(stderr, "Invalid options\n");
+        return EXIT_FAILURE;
+    }
+
+    SdlPong::MatchServer server{config};
+    if (!server.open()) {
+        std::fprintf(stderr, "Could not listen on port %d: %s\n",
+                     config.port, std::strerror(errno));
+        return EXIT_FAILURE;
+    }
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    std::printf("Serving on port %d with %d workers at %d ticks per "
+                "second\n",
+                config.port, server.getNumWorkers(), config.tickRate);
+    std::fflush(stdout);
+
+    std::thread network{[&server] { server.run(); }};
+    for (int seconds{1}; !gQuit; ++seconds) {
+        std::this_thread::sleep_for(std::chrono::seconds{1});
+        if (seconds % kReportSeconds == 0) {
+            std::printf("%d clients, %d matches, %lld late ticks\n",
+                        server.getNumClients(), server.getNumMatches(),
+                        server.getLateTicks());
+            std::fflush(stdout);
+        }
+    }
+    server.stop();
+    network.join();
+
+    return EXIT_SUCCESS;
+}
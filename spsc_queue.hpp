@@ -0,0 +1,56 @@
+#ifndef _JC_SPSC_QUEUE
+#define _JC_SPSC_QUEUE
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+
+namespace SdlPong {
+
+/* template <typename T, int Capacity> class SpscQueue {{{
+ * Bounded lock-free queue between exactly one producer thread and one
+ * consumer thread. Each side only writes its own index, and the two live
+ * on separate cache lines so pushes and pops do not slow each other down.
+ * Capacity must be a power of two.
+ * */
+template <typename T, int Capacity> class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+  public:
+    // Producer only. Returns false, dropping value, when the queue is full.
+    bool push(const T &value) {
+        const std::size_t tail{mTail.load(std::memory_order_relaxed)};
+        if (tail - mHead.load(std::memory_order_acquire) == Capacity)
+            return false;
+        mSlots[tail % Capacity] = value;
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only
+    bool empty() const {
+        return mHead.load(std::memory_order_relaxed) ==
+               mTail.load(std::memory_order_acquire);
+    }
+
+    // Consumer only
+    std::optional<T> pop() {
+        const std::size_t head{mHead.load(std::memory_order_relaxed)};
+        if (head == mTail.load(std::memory_order_acquire))
+            return std::nullopt;
+        T value{mSlots[head % Capacity]};
+        mHead.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+  private:
+    // Both only ever grow; the difference is the number of queued values
+    alignas(64) std::atomic<std::size_t> mHead{0};
+    alignas(64) std::atomic<std::size_t> mTail{0};
+    alignas(64) T mSlots[Capacity];
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_SPSC_QUEUE */
@@ -0,0 +1,451 @@
+#include "trajectory.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char kMagic[8] = {'P', 'O', 'N', 'G', 'T', 'R', 'J', '1'};
+
+struct ColumnSpec {
+    const char *name;
+    SdlPong::TrajectoryType type;
+    int size;
+};
+
+// Indexed by SdlPong::TrajectoryColumn
+constexpr ColumnSpec kColumns[]{
+    {"ball_x", SdlPong::int32Type, 4},
+    {"ball_y", SdlPong::int32Type, 4},
+    {"ball_xvel", SdlPong::int32Type, 4},
+    {"ball_yvel", SdlPong::int32Type, 4},
+    {"left_bar_x", SdlPong::int32Type, 4},
+    {"left_bar_y", SdlPong::int32Type, 4},
+    {"left_bar_xvel", SdlPong::int32Type, 4},
+    {"left_bar_yvel", SdlPong::int32Type, 4},
+    {"right_bar_x", SdlPong::int32Type, 4},
+    {"right_bar_y", SdlPong::int32Type, 4},
+    {"right_bar_xvel", SdlPong::int32Type, 4},
+    {"right_bar_yvel", SdlPong::int32Type, 4},
+    {"left_action", SdlPong::uint8Type, 1},
+    {"right_action", SdlPong::uint8Type, 1},
+    {"reward", SdlPong::int8Type, 1},
+};
+
+static_assert(std::size(kColumns) == SdlPong::kNumTrajectoryColumns);
+
+// Bodies with state columns, four columns each starting at ballXColumn
+constexpr SdlPong::Id kRecordedBodies[]{SdlPong::ball, SdlPong::leftBar,
+                                        SdlPong::rightBar};
+
+constexpr std::uint8_t kZeros[SdlPong::kTrajectoryAlign]{};
+
+std::uint64_t AlignUp(std::uint64_t size) {
+    return (size + SdlPong::kTrajectoryAlign - 1) /
+           SdlPong::kTrajectoryAlign * SdlPong::kTrajectoryAlign;
+}
+
+} // namespace
+
+/* SdlPong::TrajectoryWriter::TrajectoryWriter {{{ */
+SdlPong::TrajectoryWriter::TrajectoryWriter(const std::string &path,
+                                            int tickRate, int chunkTicks,
+                                            int maxChunks)
+    : mFile{std::fopen(path.c_str(), "wb")}, mTickRate{tickRate},
+      mChunkTicks{chunkTicks}, mMaxChunks{maxChunks} {
+
+    assert(chunkTicks > 0 && "Chunks must hold at least one tick");
+    assert(maxChunks > 0 && "TrajectoryWriter needs at least one chunk");
+
+    mChunkBytes = 0;
+    for (int c{0}; c < kNumTrajectoryColumns; ++c) {
+        mColumnOffsets[c] = mChunkBytes;
+        mChunkBytes += AlignUp(std::size_t(chunkTicks) * kColumns[c].size);
+    }
+
+    // The header is written again with the index once the file is complete
+    TrajectoryFileHeader header{};
+    TrajectoryColumnInfo columns[kNumTrajectoryColumns]{};
+    for (int c{0}; c < kNumTrajectoryColumns; ++c) {
+        std::strncpy(columns[c].name, kColumns[c].name,
+                     sizeof(columns[c].name) - 1);
+        columns[c].type = kColumns[c].type;
+        columns[c].size = static_cast<std::uint32_t>(kColumns[c].size);
+    }
+    if (mFile == nullptr || !writePadded(&header, sizeof(header)) ||
+        !writePadded(columns, sizeof(columns)))
+        mFailed = true;
+
+    // Started even when the file failed, to hand the chunks back
+    mThread = std::thread{[this] { run(); }};
+} /* }}} */
+
+SdlPong::TrajectoryWriter::~TrajectoryWriter() { close(); }
+
+/* bool SdlPong::TrajectoryWriter::close() {{{ */
+bool SdlPong::TrajectoryWriter::close() {
+    if (mThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock{mMutex};
+            mStopping = true;
+        }
+        mQueued.notify_one();
+        mThread.join();
+        writeIndex();
+    }
+    if (mFile != nullptr && std::fclose(mFile) != 0)
+        mFailed = true;
+    mFile = nullptr;
+    return ok();
+} /* }}} */
+
+bool SdlPong::TrajectoryWriter::ok() const { return !mFailed; }
+
+/* SdlPong::TrajectoryWriter::Chunk *SdlPong::TrajectoryWriter::acquire {{{
+ * A free chunk, or a new one while the pool is below maxChunks.
+ * */
+SdlPong::TrajectoryWriter::Chunk *SdlPong::TrajectoryWriter::acquire() {
+    std::unique_lock<std::mutex> lock{mMutex};
+    const auto available{[this] {
+        return !mFree.empty() ||
+               static_cast<int>(mChunks.size()) < mMaxChunks;
+    }};
+    mFreed.wait(lock, available);
+
+    if (mFree.empty()) {
+        mChunks.push_back(std::make_unique<Chunk>());
+        mChunks.back()->bytes.resize(mChunkBytes);
+        return mChunks.back().get();
+    }
+    Chunk *chunk{mFree.back()};
+    mFree.pop_back();
+    return chunk;
+} /* }}} */
+
+void SdlPong::TrajectoryWriter::submit(Chunk *chunk) {
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        mQueue.push_back(chunk);
+    }
+    mQueued.notify_one();
+}
+
+/* void SdlPong::TrajectoryWriter::run() {{{ */
+void SdlPong::TrajectoryWriter::run() {
+    while (true) {
+        Chunk *chunk;
+        {
+            std::unique_lock<std::mutex> lock{mMutex};
+            mQueued.wait(lock,
+                         [this] { return !mQueue.empty() || mStopping; });
+            if (mQueue.empty())
+                return; // stopping and drained
+            chunk = mQueue.front();
+            mQueue.pop_front();
+        }
+
+        // The recorder cannot touch this chunk until it is freed below
+        writeChunk(*chunk);
+
+        {
+            std::lock_guard<std::mutex> lock{mMutex};
+            mFree.push_back(chunk);
+        }
+        mFreed.notify_one();
+    }
+} /* }}} */
+
+/* void SdlPong::TrajectoryWriter::writeChunk(const Chunk &chunk) {{{ */
+void SdlPong::TrajectoryWriter::writeChunk(const Chunk &chunk) {
+    if (mFailed)
+        return;
+
+    const TrajectoryChunkInfo info{.offset = mOffset,
+                                   .episode = chunk.episode,
+                                   .firstTick = chunk.firstTick,
+                                   .numTicks = chunk.numTicks,
+                                   .reserved = 0};
+
+    // Only the ticks in use of each column, so a short chunk stays short
+    for (int c{0}; c < kNumTrajectoryColumns; ++c) {
+        if (!writePadded(chunk.bytes.data() + mColumnOffsets[c],
+                         std::size_t(chunk.numTicks) * kColumns[c].size)) {
+            mFailed = true;
+            return;
+        }
+    }
+    mIndex.push_back(info);
+} /* }}} */
+
+bool SdlPong::TrajectoryWriter::writePadded(const void *data,
+                                            std::size_t size) {
+    const std::size_t padding{AlignUp(size) - size};
+    if (std::fwrite(data, 1, size, mFile) != size ||
+        std::fwrite(kZeros, 1, padding, mFile) != padding)
+        return false;
+    mOffset += size + padding;
+    return true;
+}
+
+/* void SdlPong::TrajectoryWriter::writeIndex() {{{
+ * Appends the episode and chunk tables and fills in the header. A file
+ * without them has an indexOffset of 0, which readers reject.
+ * */
+void SdlPong::TrajectoryWriter::writeIndex() {
+    if (mFailed)
+        return;
+
+    std::sort(mIndex.begin(), mIndex.end(),
+              [](const TrajectoryChunkInfo &a, const TrajectoryChunkInfo &b) {
+                  return a.episode != b.episode ? a.episode < b.episode
+                                                : a.firstTick < b.firstTick;
+              });
+
+    std::vector<TrajectoryEpisodeInfo> episodes;
+    std::uint64_t numTicks{0};
+    for (std::size_t i{0}; i < mIndex.size(); ++i) {
+        const TrajectoryChunkInfo &chunk{mIndex[i]};
+        if (episodes.empty() || episodes.back().episode != chunk.episode) {
+            episodes.push_back({.episode = chunk.episode,
+                                .firstChunk = static_cast<std::uint32_t>(i),
+                                .numChunks = 0,
+                                .numTicks = 0});
+        }
+        ++episodes.back().numChunks;
+        episodes.back().numTicks += chunk.numTicks;
+        numTicks += chunk.numTicks;
+    }
+
+    TrajectoryFileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.byteOrder = kTrajectoryByteOrder;
+    header.tickRate = static_cast<std::uint32_t>(mTickRate);
+    header.numColumns = kNumTrajectoryColumns;
+    header.chunkTicks = static_cast<std::uint32_t>(mChunkTicks);
+    header.numEpisodes = static_cast<std::uint32_t>(episodes.size());
+    header.numChunks = static_cast<std::uint32_t>(mIndex.size());
+    header.numTicks = numTicks;
+    header.indexOffset = mOffset;
+
+    if (!writePadded(episodes.data(),
+                     episodes.size() * sizeof(TrajectoryEpisodeInfo)) ||
+        !writePadded(mIndex.data(),
+                     mIndex.size() * sizeof(TrajectoryChunkInfo)) ||
+        std::fseek(mFile, 0, SEEK_SET) != 0 ||
+        std::fwrite(&header, sizeof(header), 1, mFile) != 1)
+        mFailed = true;
+} /* }}} */
+
+/* SdlPong::TrajectoryRecorder::TrajectoryRecorder {{{ */
+SdlPong::TrajectoryRecorder::TrajectoryRecorder(TrajectoryWriter &writer,
+                                                int episode,
+                                                const Simulation &sim)
+    : mWriter{writer}, mEpisode{static_cast<std::uint32_t>(episode)},
+      mBefore{sim.saveState()} {
+
+    assert(episode >= 0 && "Episode ids must not be negative");
+} /* }}} */
+
+SdlPong::TrajectoryRecorder::~TrajectoryRecorder() { flush(); }
+
+/* void SdlPong::TrajectoryRecorder::step {{{ */
+void SdlPong::TrajectoryRecorder::step(const Simulation &sim,
+                                       const Inputs &inputs) {
+    if (mChunk == nullptr) {
+        mChunk = mWriter.acquire();
+        mChunk->episode = mEpisode;
+        mChunk->firstTick = mTick;
+        mChunk->numTicks = 0;
+    }
+
+    std::uint8_t *bytes{mChunk->bytes.data()};
+    const std::size_t *offsets{mWriter.mColumnOffsets};
+    const std::size_t row{mChunk->numTicks};
+
+    for (int b{0}; b < static_cast<int>(std::size(kRecordedBodies)); ++b) {
+        const SdlPong::Id id{kRecordedBodies[b]};
+        const std::int32_t values[4]{mBefore.x[id], mBefore.y[id],
+                                     mBefore.xvel[id], mBefore.yvel[id]};
+        for (int f{0}; f < 4; ++f) {
+            std::memcpy(bytes + offsets[ballXColumn + 4 * b + f] + 4 * row,
+                        &values[f], 4);
+        }
+    }
+
+    int reward{0};
+    for (const Impact &impact : sim.getImpacts()) {
+        if (impact.kind == SdlPong::scoreImpact)
+            reward += impact.other == SdlPong::rightWall ? 1 : -1;
+    }
+    bytes[offsets[leftActionColumn] + row] =
+        static_cast<std::uint8_t>(inputs.left);
+    bytes[offsets[rightActionColumn] + row] =
+        static_cast<std::uint8_t>(inputs.right);
+    bytes[offsets[rewardColumn] + row] =
+        static_cast<std::uint8_t>(static_cast<std::int8_t>(reward));
+
+    mBefore = sim.saveState();
+    ++mTick;
+    if (++mChunk->numTicks == static_cast<std::uint32_t>(mWriter.mChunkTicks))
+        flush();
+} /* }}} */
+
+void SdlPong::TrajectoryRecorder::flush() {
+    if (mChunk != nullptr) {
+        mWriter.submit(mChunk);
+        mChunk = nullptr;
+    }
+}
+
+SdlPong::TrajectoryDataset::~TrajectoryDataset() { close(); }
+
+/* bool SdlPong::TrajectoryDataset::open(const std::string &path) {{{ */
+bool SdlPong::TrajectoryDataset::open(const std::string &path) {
+    close();
+
+#ifdef _WIN32
+    std::ifstream file{path, std::ios::binary};
+    if (!file.is_open())
+        return false;
+    mCopy.assign(std::istreambuf_iterator<char>{file}, {});
+    mData = mCopy.data();
+    mSize = mCopy.size();
+#else
+    const int fd{::open(path.c_str(), O_RDONLY)};
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void *data{::mmap(nullptr, static_cast<std::size_t>(info.st_size),
+                      PROT_READ, MAP_PRIVATE, fd, 0)};
+    // The mapping keeps the file open
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    mData = static_cast<const std::uint8_t *>(data);
+    mSize = static_cast<std::size_t>(info.st_size);
+#endif
+
+    const auto fits{[this](std::uint64_t offset, std::uint64_t size) {
+        return offset <= mSize && size <= mSize - offset;
+    }};
+
+    if (!fits(0, sizeof(TrajectoryFileHeader))) {
+        close();
+        return false;
+    }
+    const TrajectoryFileHeader &header{getHeader()};
+    const std::uint64_t columnsOffset{AlignUp(sizeof(TrajectoryFileHeader))};
+    const std::uint64_t chunksOffset{
+        header.indexOffset +
+        AlignUp(std::uint64_t(header.numEpisodes) *
+                sizeof(TrajectoryEpisodeInfo))};
+
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.byteOrder != kTrajectoryByteOrder || header.indexOffset == 0 ||
+        !fits(columnsOffset,
+              std::uint64_t(header.numColumns) *
+                  sizeof(TrajectoryColumnInfo)) ||
+        !fits(header.indexOffset, chunksOffset - header.indexOffset) ||
+        !fits(chunksOffset, std::uint64_t(header.numChunks) *
+                                sizeof(TrajectoryChunkInfo))) {
+        close();
+        return false;
+    }
+    mColumns = reinterpret_cast<const TrajectoryColumnInfo *>(
+        mData + columnsOffset);
+    mEpisodes = reinterpret_cast<const TrajectoryEpisodeInfo *>(
+        mData + header.indexOffset);
+    mChunks =
+        reinterpret_cast<const TrajectoryChunkInfo *>(mData + chunksOffset);
+
+    // Every lookup may then trust the index
+    for (std::uint32_t i{0}; i < header.numChunks; ++i) {
+        std::uint64_t size{0};
+        for (std::uint32_t c{0}; c < header.numColumns; ++c)
+            size += AlignUp(std::uint64_t(mChunks[i].numTicks) *
+                            mColumns[c].size);
+        if (!fits(mChunks[i].offset, size)) {
+            close();
+            return false;
+        }
+    }
+    for (std::uint32_t i{0}; i < header.numEpisodes; ++i) {
+        const TrajectoryEpisodeInfo &episode{mEpisodes[i]};
+        if (episode.firstChunk > header.numChunks ||
+            episode.numChunks > header.numChunks - episode.firstChunk) {
+            close();
+            return false;
+        }
+    }
+    return true;
+} /* }}} */
+
+void SdlPong::TrajectoryDataset::close() {
+#ifndef _WIN32
+    if (mData != nullptr && mCopy.empty())
+        ::munmap(const_cast<std::uint8_t *>(mData), mSize);
+#endif
+    mCopy.clear();
+    mData = nullptr;
+    mSize = 0;
+    mColumns = nullptr;
+    mEpisodes = nullptr;
+    mChunks = nullptr;
+}
+
+const SdlPong::TrajectoryFileHeader &
+SdlPong::TrajectoryDataset::getHeader() const {
+    return *reinterpret_cast<const TrajectoryFileHeader *>(mData);
+}
+
+const SdlPong::TrajectoryColumnInfo &
+SdlPong::TrajectoryDataset::getColumn(int column) const {
+    return mColumns[column];
+}
+
+int SdlPong::TrajectoryDataset::findColumn(const std::string &name) const {
+    const int numColumns{static_cast<int>(getHeader().numColumns)};
+    for (int c{0}; c < numColumns; ++c) {
+        if (std::strncmp(mColumns[c].name, name.c_str(),
+                         sizeof(mColumns[c].name)) == 0)
+            return c;
+    }
+    return -1;
+}
+
+int SdlPong::TrajectoryDataset::getNumEpisodes() const {
+    return static_cast<int>(getHeader().numEpisodes);
+}
+
+const SdlPong::TrajectoryEpisodeInfo &
+SdlPong::TrajectoryDataset::getEpisode(int i) const {
+    return mEpisodes[i];
+}
+
+const SdlPong::TrajectoryChunkInfo &
+SdlPong::TrajectoryDataset::getChunk(int i) const {
+    return mChunks[i];
+}
+
+const void *
+SdlPong::TrajectoryDataset::getValues(const TrajectoryChunkInfo &chunk,
+                                      int column) const {
+    std::uint64_t offset{chunk.offset};
+    for (int c{0}; c < column; ++c)
+        offset += AlignUp(std::uint64_t(chunk.numTicks) * mColumns[c].size);
+    return mData + offset;
+}
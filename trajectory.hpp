@@ -0,0 +1,237 @@
+#ifndef _JC_TRAJECTORY
+#define _JC_TRAJECTORY
+
+#include "pong_sim.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Trajectory datasets for training: the state, actions and rewards of every
+// tick of many matches, stored column by column in a PONGTRJ1 file that
+// readers map into memory and slice without copying.
+//
+// File layout, every integer in the byte order of the machine that wrote it
+// (see byteOrder), every part starting at a multiple of kTrajectoryAlign:
+//   TrajectoryFileHeader
+//   TrajectoryColumnInfo[numColumns]
+//   chunks: each column of the chunk in turn, numTicks values, zero padded
+//   TrajectoryEpisodeInfo[numEpisodes], by episode id, at indexOffset
+//   TrajectoryChunkInfo[numChunks], by episode and then tick
+// A chunk holds consecutive ticks of one episode, so an episode is a run of
+// chunks and each of its columns a run of plain arrays.
+
+namespace SdlPong {
+
+// One row per tick: the state before the tick, the inputs of the tick and
+// the points it scored. State columns are Q16.16 world units.
+enum TrajectoryColumn {
+    ballXColumn,
+    ballYColumn,
+    ballXvelColumn,
+    ballYvelColumn,
+    leftBarXColumn,
+    leftBarYColumn,
+    leftBarXvelColumn,
+    leftBarYvelColumn,
+    rightBarXColumn,
+    rightBarYColumn,
+    rightBarXvelColumn,
+    rightBarYvelColumn,
+    leftActionColumn,  // BarDirection
+    rightActionColumn, // BarDirection
+    rewardColumn,      // +1 when left scored, -1 when right scored
+};
+
+constexpr int kNumTrajectoryColumns{rewardColumn + 1};
+
+enum TrajectoryType { int32Type, uint8Type, int8Type };
+
+constexpr std::uint32_t kTrajectoryByteOrder{0x01020304};
+constexpr int kTrajectoryAlign{64};
+
+struct TrajectoryFileHeader {
+    char magic[8];
+    std::uint32_t byteOrder; // kTrajectoryByteOrder
+    std::uint32_t tickRate;
+    std::uint32_t numColumns;
+    std::uint32_t chunkTicks; // most ticks in a chunk
+    std::uint32_t numEpisodes;
+    std::uint32_t numChunks;
+    std::uint64_t numTicks;
+    std::uint64_t indexOffset; // 0 until the writer closed the file
+    std::uint8_t reserved[16];
+};
+
+struct TrajectoryColumnInfo {
+    char name[24]; // zero terminated, such as "ball_x"
+    std::uint32_t type; // TrajectoryType
+    std::uint32_t size; // bytes per value
+};
+
+struct TrajectoryEpisodeInfo {
+    std::uint32_t episode;
+    std::uint32_t firstChunk;
+    std::uint32_t numChunks;
+    std::uint32_t numTicks;
+};
+
+struct TrajectoryChunkInfo {
+    std::uint64_t offset; // from the start of the file
+    std::uint32_t episode;
+    std::uint32_t firstTick; // within the episode
+    std::uint32_t numTicks;
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(TrajectoryFileHeader) == kTrajectoryAlign);
+static_assert(sizeof(TrajectoryColumnInfo) == 32);
+static_assert(sizeof(TrajectoryEpisodeInfo) == 16);
+static_assert(sizeof(TrajectoryChunkInfo) == 24);
+
+/* class TrajectoryWriter {{{
+ * Writes a trajectory file on a background thread. TrajectoryRecorders on
+ * any number of threads fill chunks from a pool that is allocated as
+ * needed, up to maxChunks, and only wait when every chunk is queued for
+ * writing. The index is written when the writer is destroyed.
+ * */
+class TrajectoryWriter {
+  public:
+    static constexpr int kDefaultChunkTicks{4096};
+
+    TrajectoryWriter(const std::string &path, int tickRate,
+                     int chunkTicks = kDefaultChunkTicks,
+                     int maxChunks = 16);
+    // Calls close()
+    ~TrajectoryWriter();
+
+    TrajectoryWriter(const TrajectoryWriter &) = delete;
+    TrajectoryWriter &operator=(const TrajectoryWriter &) = delete;
+
+    // Writes every submitted chunk and the index and closes the file. No
+    // recorder may be left. Returns ok().
+    bool close();
+
+    // False once the file could not be opened or written
+    bool ok() const;
+
+  private:
+    friend class TrajectoryRecorder;
+
+    struct Chunk {
+        std::uint32_t episode;
+        std::uint32_t firstTick;
+        std::uint32_t numTicks;
+        // Columns of chunkTicks values each, at mColumnOffsets
+        std::vector<std::uint8_t> bytes;
+    };
+
+    Chunk *acquire();
+    void submit(Chunk *chunk);
+
+    void run();
+    void writeChunk(const Chunk &chunk);
+    bool writePadded(const void *data, std::size_t size);
+    void writeIndex();
+
+    std::FILE *mFile;
+    int mTickRate;
+    int mChunkTicks;
+    int mMaxChunks;
+    std::size_t mColumnOffsets[kNumTrajectoryColumns];
+    std::size_t mChunkBytes;
+
+    std::mutex mMutex;
+    std::condition_variable mQueued;
+    std::condition_variable mFreed;
+    std::vector<std::unique_ptr<Chunk>> mChunks;
+    std::vector<Chunk *> mFree;
+    std::deque<Chunk *> mQueue;
+    bool mStopping{false};
+    std::atomic<bool> mFailed{false};
+
+    // Writer thread only
+    std::uint64_t mOffset{0};
+    std::vector<TrajectoryChunkInfo> mIndex;
+
+    std::thread mThread;
+}; /* }}} */
+
+/* class TrajectoryRecorder {{{
+ * Records one match as an episode of a TrajectoryWriter. Use one per match
+ * and thread; episode ids must be unique within the file.
+ * */
+class TrajectoryRecorder {
+  public:
+    // Starts from sim's current state
+    TrajectoryRecorder(TrajectoryWriter &writer, int episode,
+                       const Simulation &sim);
+    // Submits the ticks not written yet
+    ~TrajectoryRecorder();
+
+    TrajectoryRecorder(const TrajectoryRecorder &) = delete;
+    TrajectoryRecorder &operator=(const TrajectoryRecorder &) = delete;
+
+    // Call after every Simulation::step with the inputs it was given
+    void step(const Simulation &sim, const Inputs &inputs);
+
+  private:
+    void flush();
+
+    TrajectoryWriter &mWriter;
+    std::uint32_t mEpisode;
+    std::uint32_t mTick{0};
+    TrajectoryWriter::Chunk *mChunk{nullptr};
+    SimState mBefore;
+}; /* }}} */
+
+/* class TrajectoryDataset {{{
+ * A trajectory file mapped into memory. Columns point straight into the
+ * mapping, so they stay valid as long as the dataset.
+ * */
+class TrajectoryDataset {
+  public:
+    TrajectoryDataset() = default;
+    ~TrajectoryDataset();
+
+    TrajectoryDataset(const TrajectoryDataset &) = delete;
+    TrajectoryDataset &operator=(const TrajectoryDataset &) = delete;
+
+    // Returns false on I/O errors and for files that are not complete
+    // trajectory files written on a machine of the same byte order
+    bool open(const std::string &path);
+    void close();
+
+    const TrajectoryFileHeader &getHeader() const;
+    const TrajectoryColumnInfo &getColumn(int column) const;
+    // -1 when there is no column of that name
+    int findColumn(const std::string &name) const;
+
+    int getNumEpisodes() const;
+    const TrajectoryEpisodeInfo &getEpisode(int i) const;
+    const TrajectoryChunkInfo &getChunk(int i) const;
+
+    // The numTicks values of column in chunk, as getColumn(column).type
+    const void *getValues(const TrajectoryChunkInfo &chunk, int column) const;
+
+  private:
+    const std::uint8_t *mData{nullptr};
+    std::size_t mSize{0};
+    // Only used where files cannot be mapped
+    std::vector<std::uint8_t> mCopy;
+
+    const TrajectoryColumnInfo *mColumns{nullptr};
+    const TrajectoryEpisodeInfo *mEpisodes{nullptr};
+    const TrajectoryChunkInfo *mChunks{nullptr};
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_TRAJECTORY */
@@ -0,0 +1,55 @@
+#ifndef _JC_TRIPLE_BUFFER
+#define _JC_TRIPLE_BUFFER
+
+#include <atomic>
+#include <cstdint>
+
+namespace SdlPong {
+
+/* template <typename T> class TripleBuffer {{{
+ * Hands the newest value from one writer thread to one reader thread
+ * without locks and without either side ever waiting. The writer fills the
+ * back buffer and publishes it by swapping it with the middle one; the
+ * reader swaps the middle one with its front buffer when it holds something
+ * new. Values published while the reader is busy replace each other, so
+ * the reader always sees the latest and never a half-written one.
+ * */
+template <typename T> class TripleBuffer {
+  public:
+    // Writer only: the buffer to fill for the next publish(). It holds
+    // whatever was published two swaps ago, not the last value written.
+    T &back() { return mBuffers[mBack]; }
+
+    // Writer only
+    void publish() {
+        const auto fresh{static_cast<std::uint8_t>(mBack | kFresh)};
+        mBack = mMiddle.exchange(fresh, std::memory_order_acq_rel) & kIndex;
+    }
+
+    // Reader only: move to the newest published value. Returns false, and
+    // keeps the current one, if nothing was published since the last call.
+    bool update() {
+        if ((mMiddle.load(std::memory_order_relaxed) & kFresh) == 0)
+            return false;
+        mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & kIndex;
+        return true;
+    }
+
+    // Reader only
+    const T &front() const { return mBuffers[mFront]; }
+
+  private:
+    // The middle buffer's index, plus kFresh when the writer has published
+    // it and the reader has not taken it yet
+    static constexpr std::uint8_t kIndex{3};
+    static constexpr std::uint8_t kFresh{4};
+
+    T mBuffers[3]{};
+    std::uint8_t mBack{0};  // writer thread
+    std::uint8_t mFront{1}; // reader thread
+    std::atomic<std::uint8_t> mMiddle{2};
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_TRIPLE_BUFFER */
@@ -0,0 +1,48 @@
+#ifndef _JC_WORK_QUEUE
+#define _JC_WORK_QUEUE
+
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace SdlPong {
+
+/* template <typename T> class WorkStealingQueue {{{
+ * Per-worker task queue. The owning worker pushes and pops at the back so it
+ * keeps working on what it queued last, while idle workers steal from the
+ * front, where the oldest tasks are. Each queue has its own lock, so workers
+ * only contend when one of them is stealing.
+ * */
+template <typename T> class WorkStealingQueue {
+  public:
+    void push(T task) {
+        std::lock_guard<std::mutex> lock{mMutex};
+        mTasks.push_back(std::move(task));
+    }
+
+    std::optional<T> pop() {
+        std::lock_guard<std::mutex> lock{mMutex};
+        if (mTasks.empty())
+            return std::nullopt;
+        T task{std::move(mTasks.back())};
+        mTasks.pop_back();
+        return task;
+    }
+
+    std::optional<T> steal() {
+        std::lock_guard<std::mutex> lock{mMutex};
+        if (mTasks.empty())
+            return std::nullopt;
+        T task{std::move(mTasks.front())};
+        mTasks.pop_front();
+        return task;
+    }
+
+  private:
+    std::mutex mMutex;
+    std::deque<T> mTasks;
+}; /* }}} */
+
+} // namespace SdlPong
+
+#endif /* ifndef _JC_WORK_QUEUE */